@@ -0,0 +1,4 @@
+# Prints the I/O backend of the extension on the import path; used by
+# bench/run_bench.sh to tag result files
+import network.async as async
+system.out.println(async.backend())
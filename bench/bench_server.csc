@@ -0,0 +1,73 @@
+# Benchmark target server for bench/run_bench.sh
+#
+# Usage: cs -i build/imports bench/bench_server.csc <role> <port> [master_port] [slave_count]
+#   role: simple, master or slave
+#
+# Routes:
+#   /hello       small fixed response
+#   /echo        echoes the request body (large-body runs)
+#   /large       64 KiB response
+# A master launches slave_count slaves running this script itself, using
+# the interpreter given by the CS environment variable (default: cs) and
+# the import path given by BENCH_IMPORTS (default: build/imports).
+
+import netutils
+
+var args = context.cmd_args
+if args.size < 3
+    system.out.println("Usage: bench_server.csc <simple|master|slave> <port> [master_port] [slave_count]")
+    system.exit(2)
+end
+var role = args[1]
+var port = args[2] as integer
+var master_port = (args.size > 3 ? args[3] as integer : port + 1)
+var slave_count = (args.size > 4 ? args[4] as integer : 4)
+
+var large_body = new string
+while large_body.size < 65536
+    large_body.append("0123456789abcdef")
+end
+
+var server = (new netutils.http_server).set_config({
+    "thread_count": 4,
+    "worker_count": 64,
+    "master_worker_count": 8,
+    "max_keep_alive": 1000000,
+    "max_connections": 4096,
+    "max_body_size": 67108864,
+    "request_metrics": false
+}.to_hash_map())
+
+server.bind_route("GET", "/hello", [](server, session){
+    session.send_response(netutils.state_codes.code_200, "Hello, world!", "text/plain")
+})
+server.bind_route("POST", "/echo", [](server, session){
+    session.send_response(netutils.state_codes.code_200, session.post_data, "application/octet-stream")
+})
+server.bind_route("GET", "/large", [large_body](server, session){
+    session.send_response(netutils.state_codes.code_200, large_body, "text/plain")
+})
+
+switch role
+    case "simple"
+        server.listen(port)
+    end
+    case "master"
+        var cs = system.getenv("CS")
+        if cs == null || cs.empty()
+            cs = "cs"
+        end
+        var imports = system.getenv("BENCH_IMPORTS")
+        if imports == null || imports.empty()
+            imports = "build/imports"
+        end
+        server.set_config({"slave_count": slave_count}.to_hash_map())
+        server.set_slave_command({cs, "-i", imports, "bench/bench_server.csc", "slave", to_string(port), to_string(master_port)})
+        server.set_master(master_port).listen(port)
+    end
+    default
+        server.set_slave("127.0.0.1", master_port)
+    end
+end
+
+server.run()
@@ -0,0 +1,77 @@
+# Compare two bench/run_bench.sh result files scenario by scenario
+#
+# Usage: cs -i build/imports bench/compare.csc <base.json> <new.json> [max_regression_percent]
+#
+# Prints RPS and p50/p99/p999 latency of both runs with the relative
+# change. With max_regression_percent, exits with status 1 when a
+# scenario loses more RPS or gains more p99 latency than that.
+
+import codec.json
+
+var args = context.cmd_args
+if args.size < 3
+    system.out.println("Usage: compare.csc <base.json> <new.json> [max_regression_percent]")
+    system.exit(2)
+end
+
+function load(path)
+    var result = json.to_var(json.from_stream(iostream.ifstream(path)))
+    var scenarios = new hash_map
+    foreach s in result["scenarios"]
+        scenarios.insert(s["name"], s)
+    end
+    var label = result["commit"]
+    if result.exist("backend")
+        label += " (" + result["backend"] + ")"
+    end
+    return {label, scenarios}
+end
+
+function pad(s, width)
+    s = to_string(s)
+    while s.size < width
+        s = " " + s
+    end
+    return s
+end
+
+# Relative change in whole percent
+function change(base, cur)
+    if base == 0
+        return 0
+    end
+    return ((cur - base) * 100 / base) as integer
+end
+
+function signed(n)
+    return (n > 0 ? "+" : "") + to_string(n) + "%"
+end
+
+var (base_commit, base) = load(args[1])
+var (cur_commit, cur) = load(args[2])
+var limit = (args.size > 3 ? args[3] as integer : -1)
+var failed = false
+
+system.out.println("base: " + base_commit + "  new: " + cur_commit)
+system.out.println(pad("scenario", 24) + pad("rps", 12) + pad("Δ", 8) + pad("p50 us", 10) + pad("p99 us", 10) + pad("Δ", 8) + pad("p999 us", 10))
+foreach it in cur
+    var name = it.first
+    var c = it.second
+    if !base.exist(name)
+        system.out.println(pad(name, 24) + pad(c["rps"] as integer, 12) + pad("new", 8))
+        continue
+    end
+    var b = base[name]
+    var rps_change = change(b["rps"], c["rps"])
+    var p99_change = change(b["latency_us"]["p99"], c["latency_us"]["p99"])
+    var latency = c["latency_us"]
+    system.out.println(pad(name, 24) + pad(c["rps"] as integer, 12) + pad(signed(rps_change), 8) + pad(latency["p50"], 10) + pad(latency["p99"], 10) + pad(signed(p99_change), 8) + pad(latency["p999"], 10))
+    if limit >= 0 && (-rps_change > limit || p99_change > limit)
+        system.out.println("  regression in " + name)
+        failed = true
+    end
+end
+
+if failed
+    system.exit(1)
+end
@@ -0,0 +1,482 @@
+/*
+ * Covariant Script Network - HTTP load generator
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Copyright (C) 2017-2026 Michael Lee(李登淳)
+ *
+ * Email:   mikecovlee@163.com
+ * Github:  https://github.com/mikecovlee
+ * Website: http://covscript.org.cn
+ */
+/*
+ * Closed-loop HTTP/1.1 load generator built on the same standalone Asio
+ * as the extension. Each thread owns an io_context and a share of the
+ * connections; every connection writes a batch of --pipeline requests,
+ * reads the responses back and starts over until --duration expires.
+ * Latency is measured per request from the write of its batch to the
+ * end of its response, kept exactly (no sampling) and reported with the
+ * throughput as one JSON object on stdout.
+ */
+#define ASIO_STANDALONE
+
+#include <asio.hpp>
+#include <asio/ssl.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bench {
+	using asio::ip::tcp;
+	using clock_type = std::chrono::steady_clock;
+
+	struct options {
+		std::string name = "default";
+		std::string host = "127.0.0.1";
+		std::string port = "8080";
+		std::string path = "/";
+		std::string method = "GET";
+		std::size_t connections = 16;
+		std::size_t threads = 1;
+		std::size_t pipeline = 1;
+		std::size_t body_size = 0;
+		double duration = 10;
+		double warmup = 1;
+		bool keep_alive = true;
+		bool tls = false;
+		bool verify = true;
+		std::string sni;
+	};
+
+	struct stats {
+		std::vector<std::uint64_t> latencies;
+		std::uint64_t non_2xx = 0;
+		std::uint64_t errors = 0;
+		std::uint64_t connects = 0;
+		std::uint64_t bytes_read = 0;
+
+		void merge(const stats &other)
+		{
+			latencies.insert(latencies.end(), other.latencies.begin(), other.latencies.end());
+			non_2xx += other.non_2xx;
+			errors += other.errors;
+			connects += other.connects;
+			bytes_read += other.bytes_read;
+		}
+	};
+
+	struct run_state {
+		const options &opts;
+		std::string request;
+		clock_type::time_point measure_from;
+		clock_type::time_point deadline;
+		std::atomic<bool> stopping{false};
+		asio::ssl::context ssl_ctx{asio::ssl::context::tls_client};
+
+		explicit run_state(const options &o) : opts(o)
+		{
+			std::string body(o.body_size, 'x');
+			request = o.method + " " + o.path + " HTTP/1.1\r\nHost: " + o.host + "\r\n";
+			request += o.keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+			if (o.body_size > 0 || o.method == "POST" || o.method == "PUT")
+				request += "Content-Type: application/octet-stream\r\nContent-Length: " + std::to_string(o.body_size) + "\r\n";
+			request += "\r\n" + body;
+			if (o.tls) {
+				if (o.verify) {
+					ssl_ctx.set_default_verify_paths();
+					ssl_ctx.set_verify_mode(asio::ssl::verify_peer);
+				}
+				else
+					ssl_ctx.set_verify_mode(asio::ssl::verify_none);
+			}
+		}
+	};
+
+	static bool iequals(const std::string &s, std::size_t pos, const char *lower)
+	{
+		for (; *lower; ++lower, ++pos) {
+			if (pos >= s.size() || std::tolower(static_cast<unsigned char>(s[pos])) != *lower)
+				return false;
+		}
+		return true;
+	}
+
+	class connection : public std::enable_shared_from_this<connection> {
+		run_state &run;
+		stats &out;
+		tcp::resolver::results_type endpoints;
+		tcp::socket sock;
+		std::unique_ptr<asio::ssl::stream<tcp::socket &>> tls;
+		asio::streambuf buffer;
+		std::string batch;
+		std::size_t pending = 0;
+		clock_type::time_point sent_at;
+
+		template <typename F>
+		void with_stream(F &&fn)
+		{
+			if (tls)
+				fn(*tls);
+			else
+				fn(sock);
+		}
+
+		bool measuring() const
+		{
+			return sent_at >= run.measure_from;
+		}
+
+		// Errors during warmup or after the deadline are not reported
+		void count_error()
+		{
+			if (clock_type::now() >= run.measure_from && !run.stopping.load(std::memory_order_relaxed))
+				++out.errors;
+		}
+
+		void fail()
+		{
+			count_error();
+			restart();
+		}
+
+		void restart()
+		{
+			asio::error_code ec;
+			sock.close(ec);
+			tls.reset();
+			buffer.consume(buffer.size());
+			pending = 0;
+			if (!run.stopping.load(std::memory_order_relaxed))
+				start();
+		}
+
+		void on_connected()
+		{
+			++out.connects;
+			asio::error_code ec;
+			sock.set_option(tcp::no_delay(true), ec);
+			if (!run.opts.tls) {
+				send_batch();
+				return;
+			}
+			tls = std::make_unique<asio::ssl::stream<tcp::socket &>>(sock, run.ssl_ctx);
+			const std::string &sni = run.opts.sni.empty() ? run.opts.host : run.opts.sni;
+			SSL_set_tlsext_host_name(tls->native_handle(), sni.c_str());
+			if (run.opts.verify)
+				tls->set_verify_callback(asio::ssl::host_name_verification(sni));
+			auto self = shared_from_this();
+			tls->async_handshake(asio::ssl::stream_base::client, [self](const asio::error_code &ec) {
+				if (ec)
+					self->fail();
+				else
+					self->send_batch();
+			});
+		}
+
+		void send_batch()
+		{
+			if (run.stopping.load(std::memory_order_relaxed) || clock_type::now() >= run.deadline) {
+				run.stopping.store(true, std::memory_order_relaxed);
+				return;
+			}
+			pending = run.opts.keep_alive ? run.opts.pipeline : 1;
+			sent_at = clock_type::now();
+			auto self = shared_from_this();
+			with_stream([&](auto &stream) {
+				asio::async_write(stream, asio::buffer(batch), [self](const asio::error_code &ec, std::size_t) {
+					if (ec)
+						self->fail();
+					else
+						self->read_header();
+				});
+			});
+		}
+
+		void read_header()
+		{
+			auto self = shared_from_this();
+			with_stream([&](auto &stream) {
+				asio::async_read_until(stream, buffer, "\r\n\r\n", [self](const asio::error_code &ec, std::size_t n) {
+					if (ec)
+						self->fail();
+					else
+						self->on_header(n);
+				});
+			});
+		}
+
+		void on_header(std::size_t header_size)
+		{
+			std::string header(asio::buffers_begin(buffer.data()), asio::buffers_begin(buffer.data()) + header_size);
+			buffer.consume(header_size);
+			out.bytes_read += header_size;
+			// "HTTP/1.1 200 OK"
+			int status = header.size() > 12 ? std::atoi(header.c_str() + 9) : 0;
+			std::size_t length = 0;
+			bool has_length = false;
+			std::size_t pos = 0;
+			while ((pos = header.find("\r\n", pos)) != std::string::npos) {
+				pos += 2;
+				if (header.size() - pos > 15 && iequals(header, pos, "content-length:")) {
+					length = static_cast<std::size_t>(std::strtoull(header.c_str() + pos + 15, nullptr, 10));
+					has_length = true;
+				}
+			}
+			if (!has_length && status != 204 && status != 304 && run.opts.method != "HEAD") {
+				// Only Content-Length framing is supported
+				fail();
+				return;
+			}
+			if (run.opts.method == "HEAD")
+				length = 0;
+			if (buffer.size() >= length) {
+				on_body(status, length);
+				return;
+			}
+			auto self = shared_from_this();
+			with_stream([&](auto &stream) {
+				asio::async_read(stream, buffer, asio::transfer_exactly(length - buffer.size()),
+				[self, status, length](const asio::error_code &ec, std::size_t) {
+					if (ec)
+						self->fail();
+					else
+						self->on_body(status, length);
+				});
+			});
+		}
+
+		void on_body(int status, std::size_t length)
+		{
+			buffer.consume(length);
+			out.bytes_read += length;
+			if (measuring()) {
+				out.latencies.push_back(static_cast<std::uint64_t>(
+				                            std::chrono::duration_cast<std::chrono::microseconds>(clock_type::now() - sent_at).count()));
+				if (status < 200 || status > 299)
+					++out.non_2xx;
+			}
+			if (--pending > 0) {
+				read_header();
+				return;
+			}
+			if (run.opts.keep_alive)
+				send_batch();
+			else
+				restart();
+		}
+
+	public:
+		connection(asio::io_context &io, run_state &r, stats &s, tcp::resolver::results_type eps)
+			: run(r), out(s), endpoints(std::move(eps)), sock(io)
+		{
+			std::size_t copies = run.opts.keep_alive ? run.opts.pipeline : 1;
+			for (std::size_t i = 0; i < copies; ++i)
+				batch += run.request;
+		}
+
+		void start()
+		{
+			auto self = shared_from_this();
+			asio::async_connect(sock, endpoints, [self](const asio::error_code &ec, const tcp::endpoint &) {
+				if (ec) {
+					self->count_error();
+					if (!self->run.stopping.load(std::memory_order_relaxed) && clock_type::now() < self->run.deadline)
+						self->start();
+				}
+				else
+					self->on_connected();
+			});
+		}
+	};
+
+	static void usage()
+	{
+		std::fputs(
+		    "Usage: http_bench [options]\n"
+		    "  --name NAME          scenario name reported in the result (default)\n"
+		    "  --host HOST          server address (127.0.0.1)\n"
+		    "  --port PORT          server port (8080)\n"
+		    "  --path PATH          request target (/)\n"
+		    "  --method METHOD      request method (GET)\n"
+		    "  --connections N      concurrent connections (16)\n"
+		    "  --threads N          event loop threads (1)\n"
+		    "  --duration SEC       measured run time in seconds (10)\n"
+		    "  --warmup SEC         unmeasured run time before it (1)\n"
+		    "  --pipeline N         requests written back to back per connection (1)\n"
+		    "  --body-size BYTES    request body size (0)\n"
+		    "  --close              one request per connection (Connection: close)\n"
+		    "  --tls                connect with TLS\n"
+		    "  --sni NAME           TLS server name (defaults to --host)\n"
+		    "  --insecure           do not verify the server certificate\n",
+		    stderr);
+	}
+
+	static bool parse_options(int argc, char **argv, options &o)
+	{
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			auto value = [&]() -> std::string {
+				if (i + 1 >= argc)
+					throw std::runtime_error("Missing value for " + arg);
+				return argv[++i];
+			};
+			if (arg == "--name")
+				o.name = value();
+			else if (arg == "--host")
+				o.host = value();
+			else if (arg == "--port")
+				o.port = value();
+			else if (arg == "--path")
+				o.path = value();
+			else if (arg == "--method")
+				o.method = value();
+			else if (arg == "--connections")
+				o.connections = std::stoul(value());
+			else if (arg == "--threads")
+				o.threads = std::stoul(value());
+			else if (arg == "--duration")
+				o.duration = std::stod(value());
+			else if (arg == "--warmup")
+				o.warmup = std::stod(value());
+			else if (arg == "--pipeline")
+				o.pipeline = std::stoul(value());
+			else if (arg == "--body-size")
+				o.body_size = std::stoul(value());
+			else if (arg == "--close")
+				o.keep_alive = false;
+			else if (arg == "--tls")
+				o.tls = true;
+			else if (arg == "--sni")
+				o.sni = value();
+			else if (arg == "--insecure")
+				o.verify = false;
+			else
+				return false;
+		}
+		if (o.connections == 0 || o.threads == 0 || o.pipeline == 0 || o.duration <= 0 || o.warmup < 0)
+			throw std::runtime_error("Counts and durations must be positive.");
+		if (o.threads > o.connections)
+			o.threads = o.connections;
+		return true;
+	}
+
+	static std::uint64_t percentile(const std::vector<std::uint64_t> &sorted, double q)
+	{
+		if (sorted.empty())
+			return 0;
+		std::size_t rank = static_cast<std::size_t>(q * static_cast<double>(sorted.size()) + 0.5);
+		if (rank == 0)
+			rank = 1;
+		return sorted[(std::min)(rank, sorted.size()) - 1];
+	}
+
+	static std::string json_escape(const std::string &s)
+	{
+		std::string out;
+		for (char ch : s) {
+			if (ch == '"' || ch == '\\')
+				out += '\\';
+			out += ch;
+		}
+		return out;
+	}
+
+	static int run(const options &o)
+	{
+		run_state state(o);
+		tcp::resolver::results_type endpoints;
+		{
+			asio::io_context io;
+			tcp::resolver resolver(io);
+			endpoints = resolver.resolve(o.host, o.port);
+		}
+		std::vector<std::unique_ptr<asio::io_context>> loops;
+		std::vector<stats> per_thread(o.threads);
+		for (std::size_t i = 0; i < o.threads; ++i)
+			loops.push_back(std::make_unique<asio::io_context>());
+		auto start = clock_type::now();
+		state.measure_from = start + std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(o.warmup));
+		state.deadline = state.measure_from + std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(o.duration));
+		for (std::size_t i = 0; i < o.connections; ++i) {
+			std::size_t t = i % o.threads;
+			std::make_shared<connection>(*loops[t], state, per_thread[t], endpoints)->start();
+		}
+		std::vector<std::thread> threads;
+		for (std::size_t t = 0; t < o.threads; ++t) {
+			threads.emplace_back([&, t] {
+				asio::steady_timer stop_timer(*loops[t], state.deadline);
+				stop_timer.async_wait([&](const asio::error_code &) {
+					state.stopping.store(true, std::memory_order_relaxed);
+				});
+				// Let in-flight batches finish for a short grace period
+				// after the deadline, then abandon the stragglers.
+				loops[t]->run_until(state.deadline + std::chrono::seconds(2));
+				loops[t]->stop();
+			});
+		}
+		for (auto &th : threads)
+			th.join();
+		auto elapsed = std::chrono::duration<double>((std::min)(clock_type::now(), state.deadline) - state.measure_from).count();
+
+		stats total;
+		for (auto &s : per_thread)
+			total.merge(s);
+		std::sort(total.latencies.begin(), total.latencies.end());
+		double mean = 0;
+		for (auto v : total.latencies)
+			mean += static_cast<double>(v);
+		if (!total.latencies.empty())
+			mean /= static_cast<double>(total.latencies.size());
+		double rps = elapsed > 0 ? static_cast<double>(total.latencies.size()) / elapsed : 0;
+
+		std::printf("{\"name\":\"%s\",\"connections\":%zu,\"threads\":%zu,\"pipeline\":%zu,\"keep_alive\":%s,"
+		            "\"tls\":%s,\"body_size\":%zu,\"duration\":%.3f,\"requests\":%zu,\"errors\":%llu,\"non_2xx\":%llu,"
+		            "\"connects\":%llu,\"bytes_read\":%llu,\"rps\":%.1f,\"latency_us\":{\"min\":%llu,\"mean\":%.1f,"
+		            "\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu}}\n",
+		            json_escape(o.name).c_str(), o.connections, o.threads, o.pipeline, o.keep_alive ? "true" : "false",
+		            o.tls ? "true" : "false", o.body_size, elapsed, total.latencies.size(),
+		            static_cast<unsigned long long>(total.errors), static_cast<unsigned long long>(total.non_2xx),
+		            static_cast<unsigned long long>(total.connects), static_cast<unsigned long long>(total.bytes_read), rps,
+		            static_cast<unsigned long long>(total.latencies.empty() ? 0 : total.latencies.front()), mean,
+		            static_cast<unsigned long long>(percentile(total.latencies, 0.5)),
+		            static_cast<unsigned long long>(percentile(total.latencies, 0.9)),
+		            static_cast<unsigned long long>(percentile(total.latencies, 0.99)),
+		            static_cast<unsigned long long>(percentile(total.latencies, 0.999)),
+		            static_cast<unsigned long long>(total.latencies.empty() ? 0 : total.latencies.back()));
+		return total.latencies.empty() ? 1 : 0;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	bench::options opts;
+	try {
+		if (!bench::parse_options(argc, argv, opts)) {
+			bench::usage();
+			return 2;
+		}
+		return bench::run(opts);
+	}
+	catch (const std::exception &e) {
+		std::fprintf(stderr, "http_bench: %s\n", e.what());
+		return 2;
+	}
+}
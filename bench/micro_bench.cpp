@@ -0,0 +1,525 @@
+/*
+ * Covariant Script Network Extension
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Copyright (C) 2017-2026 Michael Lee(李登淳)
+ *
+ * Email:   mikecovlee@163.com
+ * Github:  https://github.com/mikecovlee
+ * Website: http://covscript.org.cn
+ */
+
+/*
+ * network_microbench: per-call cost of the CNI hot paths.
+ *
+ * The extension source is compiled into this executable so the benchmarks
+ * call the same functions scripts reach through network.async / network.tcp,
+ * over loopback sockets on the shared io_context. Each benchmark is
+ * calibrated until it runs for --min-time seconds and reports ns/op plus
+ * heap allocations and bytes per op (counted by a global operator new).
+ *
+ *   network_microbench [--filter <substring>] [--min-time <seconds>]
+ *                      [--json <file>] [--baseline <file>] [--tolerance <pct>]
+ *
+ * With --baseline, a previous --json output is compared against the current
+ * run; the exit status is 1 if any benchmark got slower by more than
+ * --tolerance percent (default 10) or allocates more per op than before.
+ */
+
+#include "../network.cpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace microbench {
+	std::atomic<std::uint64_t> alloc_count{0};
+	std::atomic<std::uint64_t> alloc_bytes{0};
+}
+
+// GCC pairs the replaced new/delete with malloc/free after inlining and
+// reports a false -Wmismatched-new-delete; both sides are replaced here.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void *operator new(std::size_t size)
+{
+	microbench::alloc_count.fetch_add(1, std::memory_order_relaxed);
+	microbench::alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+	if (void *p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+	return ::operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+namespace microbench {
+	using clock = std::chrono::steady_clock;
+
+	template <typename T>
+	inline void do_not_optimize(const T &value)
+	{
+#if defined(_MSC_VER)
+		static volatile const void *sink;
+		sink = &value;
+		_ReadWriteBarrier();
+#else
+		asm volatile("" : : "r,m"(value) : "memory");
+#endif
+	}
+
+	/*
+	 * Iteration state handed to each benchmark, in the shape of Google
+	 * Benchmark's State: loop on keep_running() and bracket per-iteration
+	 * setup with pause_timing()/resume_timing() so it is excluded from both
+	 * the time and the allocation counts.
+	 */
+	class state {
+		std::uint64_t max_iterations;
+		std::uint64_t iterations = 0;
+		bool started = false;
+		bool paused = false;
+		clock::time_point mark;
+		clock::duration elapsed{0};
+		std::uint64_t allocs_mark = 0, bytes_mark = 0;
+
+		void start_interval()
+		{
+			allocs_mark = alloc_count.load(std::memory_order_relaxed);
+			bytes_mark = alloc_bytes.load(std::memory_order_relaxed);
+			mark = clock::now();
+		}
+
+		void stop_interval()
+		{
+			elapsed += clock::now() - mark;
+			allocs += alloc_count.load(std::memory_order_relaxed) - allocs_mark;
+			bytes += alloc_bytes.load(std::memory_order_relaxed) - bytes_mark;
+		}
+
+	public:
+		std::uint64_t allocs = 0, bytes = 0;
+		std::string error;
+
+		explicit state(std::uint64_t n) : max_iterations(n) {}
+
+		bool keep_running()
+		{
+			if (!started) {
+				started = true;
+				start_interval();
+			}
+			else
+				++iterations;
+			if (iterations < max_iterations && error.empty())
+				return true;
+			if (!paused)
+				stop_interval();
+			return false;
+		}
+
+		void pause_timing()
+		{
+			stop_interval();
+			paused = true;
+		}
+
+		void resume_timing()
+		{
+			paused = false;
+			start_interval();
+		}
+
+		void skip_with_error(const std::string &msg)
+		{
+			error = msg;
+		}
+
+		std::uint64_t count() const
+		{
+			return iterations;
+		}
+
+		double seconds() const
+		{
+			return std::chrono::duration<double>(elapsed).count();
+		}
+	};
+
+	struct benchmark {
+		std::string name;
+		std::function<void(state &)> fn;
+	};
+
+	std::vector<benchmark> &registry()
+	{
+		static std::vector<benchmark> benchmarks;
+		return benchmarks;
+	}
+
+	struct registrar {
+		registrar(const char *name, std::function<void(state &)> fn)
+		{
+			registry().push_back({name, std::move(fn)});
+		}
+	};
+
+#define MICROBENCH_CAT2(a, b) a##b
+#define MICROBENCH_CAT(a, b) MICROBENCH_CAT2(a, b)
+#define MICROBENCH(name, ...) \
+	static ::microbench::registrar MICROBENCH_CAT(microbench_registrar_, __LINE__)(name, __VA_ARGS__)
+
+	struct result {
+		std::string name;
+		std::uint64_t iterations = 0;
+		double ns_per_op = 0;
+		double allocs_per_op = 0;
+		double bytes_per_op = 0;
+		std::string error;
+	};
+
+	result run(const benchmark &bm, double min_time)
+	{
+		std::uint64_t n = 1;
+		while (true) {
+			state st(n);
+			auto round_start = clock::now();
+			bm.fn(st);
+			if (!st.error.empty())
+				return {bm.name, 0, 0, 0, 0, st.error};
+			double secs = st.seconds();
+			// Benchmarks whose setup runs with timing paused would otherwise
+			// keep growing long after the timed part reached min_time; cap a
+			// round at 5x min_time of wall clock as well.
+			double wall = std::chrono::duration<double>(clock::now() - round_start).count();
+			if (secs >= min_time || wall >= 5 * min_time || n >= 1000000000ull) {
+				double iters = static_cast<double>(std::max<std::uint64_t>(st.count(), 1));
+				return {bm.name, st.count(), secs * 1e9 / iters, st.allocs / iters, st.bytes / iters, {}};
+			}
+			// Same growth rule as Google Benchmark: aim 40% past the target,
+			// never more than 10x per round.
+			double effective = std::max(secs, wall / 5);
+			double multiplier = effective <= 0 ? 10.0 : std::min(10.0, std::max(1.4 * min_time / effective, 2.0));
+			n = static_cast<std::uint64_t>(n * multiplier);
+		}
+	}
+
+	void write_json(std::ostream &os, const std::vector<result> &results)
+	{
+		// One object per line so --baseline can read it back without a parser.
+		os << "[\n";
+		for (std::size_t i = 0; i < results.size(); ++i) {
+			const auto &r = results[i];
+			char line[512];
+			std::snprintf(line, sizeof(line),
+			              "  {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.2f, \"allocs_per_op\": %.2f, \"bytes_per_op\": %.1f}%s\n",
+			              r.name.c_str(), static_cast<unsigned long long>(r.iterations), r.ns_per_op, r.allocs_per_op, r.bytes_per_op,
+			              i + 1 < results.size() ? "," : "");
+			os << line;
+		}
+		os << "]\n";
+	}
+
+	std::map<std::string, result> read_baseline(const std::string &path)
+	{
+		std::map<std::string, result> baseline;
+		std::ifstream in(path);
+		if (!in)
+			throw std::runtime_error("cannot open baseline " + path);
+		std::string line;
+		while (std::getline(in, line)) {
+			char name[256] = {0};
+			unsigned long long iterations = 0;
+			result r;
+			if (std::sscanf(line.c_str(), " {\"name\": \"%255[^\"]\", \"iterations\": %llu, \"ns_per_op\": %lf, \"allocs_per_op\": %lf, \"bytes_per_op\": %lf",
+			                name, &iterations, &r.ns_per_op, &r.allocs_per_op, &r.bytes_per_op) == 5) {
+				r.name = name;
+				r.iterations = iterations;
+				baseline[r.name] = r;
+			}
+		}
+		return baseline;
+	}
+}
+
+namespace microbench {
+	namespace async = network_cs_ext::async;
+	namespace tcp = network_cs_ext::tcp;
+
+	// A connected loopback TCP pair of extension sockets.
+	struct loopback_pair {
+		tcp::socket_t client = std::make_shared<cs_impl::network::tcp::socket>();
+		tcp::socket_t server = std::make_shared<cs_impl::network::tcp::socket>();
+
+		loopback_pair()
+		{
+			asio::ip::tcp::acceptor acceptor(cs_impl::network::get_io_context(),
+			                                 asio::ip::tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+			client->connect(acceptor.local_endpoint());
+			server->accept(acceptor);
+			client->get_raw().set_option(asio::ip::tcp::no_delay(true));
+			server->get_raw().set_option(asio::ip::tcp::no_delay(true));
+		}
+	};
+
+	// Drive the shared io_context the way async.wait does, minus the yield.
+	void drive(const async::state_t &st)
+	{
+		while (!async::has_done(st))
+			async::poll();
+	}
+
+	MICROBENCH("fixed_hex/to", [](state &st) {
+		long long i = 0;
+		while (st.keep_running())
+			do_not_optimize(network_cs_ext::to_fixed_hex(cs::numeric(i++ & 0xffffff)));
+	});
+
+	MICROBENCH("fixed_hex/from", [](state &st) {
+		const std::string hex = network_cs_ext::to_fixed_hex(cs::numeric(0x123456));
+		while (st.keep_running())
+			do_not_optimize(network_cs_ext::from_fixed_hex(hex));
+	});
+
+	MICROBENCH("async/create_state", [](state &st) {
+		while (st.keep_running())
+			do_not_optimize(async::create_async_state());
+	});
+
+	// async.read setup + completion for data already queued on the socket.
+	MICROBENCH("async/read_64", [](state &st) {
+		loopback_pair pair;
+		const std::string payload(64, 'x');
+		while (st.keep_running()) {
+			st.pause_timing();
+			pair.client->write(payload);
+			st.resume_timing();
+			auto s = async::read(pair.server, 64);
+			drive(s);
+			do_not_optimize(async::get_result(s));
+		}
+	});
+
+	// async.read_until on a reused state, as read_http_header does per line.
+	MICROBENCH("async/read_until_line", [](state &st) {
+		loopback_pair pair;
+		const std::string line = "Host: 127.0.0.1\r\n";
+		auto s = async::create_async_state();
+		while (st.keep_running()) {
+			st.pause_timing();
+			pair.client->write(line);
+			st.resume_timing();
+			async::read_until(pair.server, s, "\r\n");
+			drive(s);
+			do_not_optimize(async::get_result(s));
+		}
+	});
+
+	// get_result copy out of the streambuf, by payload size.
+	void get_result_copy(state &st, std::size_t size)
+	{
+		const std::string payload(size, 'x');
+		auto s = async::create_async_state();
+		s->init = s->is_read = true;
+		s->has_done.store(true);
+		while (st.keep_running()) {
+			st.pause_timing();
+			std::ostream os(&s->buffer);
+			os.write(payload.data(), payload.size());
+			s->bytes_transferred = payload.size();
+			st.resume_timing();
+			do_not_optimize(async::get_result(s));
+		}
+	}
+
+	MICROBENCH("async/get_result/64", [](state &st) {
+		get_result_copy(st, 64);
+	});
+	MICROBENCH("async/get_result/4096", [](state &st) {
+		get_result_copy(st, 4096);
+	});
+	MICROBENCH("async/get_result/65536", [](state &st) {
+		get_result_copy(st, 65536);
+	});
+
+	// async.wait latency: post a read, let the peer write, wait for it.
+	MICROBENCH("async/wait_loopback", [](state &st) {
+		loopback_pair pair;
+		const std::string payload(64, 'x');
+		while (st.keep_running()) {
+			auto s = async::read(pair.server, 64);
+			pair.client->write(payload);
+			async::wait(s);
+			do_not_optimize(async::get_result(s));
+		}
+	});
+
+	// safe_shutdown on an idle connection.
+	MICROBENCH("tcp/safe_shutdown_idle", [](state &st) {
+		while (st.keep_running()) {
+			st.pause_timing();
+			auto pair = std::make_unique<loopback_pair>();
+			st.resume_timing();
+			do_not_optimize(tcp::socket::safe_shutdown(pair->server));
+			st.pause_timing();
+			pair.reset();
+			st.resume_timing();
+		}
+	});
+
+	// safe_shutdown draining an outstanding async.read.
+	MICROBENCH("tcp/safe_shutdown_pending_read", [](state &st) {
+		while (st.keep_running()) {
+			st.pause_timing();
+			auto pair = std::make_unique<loopback_pair>();
+			auto s = async::read(pair->server, 64);
+			st.resume_timing();
+			do_not_optimize(tcp::socket::safe_shutdown(pair->server));
+			st.pause_timing();
+			drive(s);
+			pair.reset();
+			st.resume_timing();
+		}
+	});
+
+	// TLS client context: trust store loading dominates in auto mode.
+	void tls_context(state &st, cs_impl::network::ssl_trust_mode mode)
+	{
+		cs_impl::network::ssl_options options;
+		options.trust_mode = mode;
+		if (mode == cs_impl::network::ssl_trust_mode::insecure)
+			options.verify_peer = options.verify_host = false;
+		while (st.keep_running()) {
+			asio::ssl::context ctx(asio::ssl::context::tls_client);
+			do_not_optimize(cs_impl::network::detail::configure_client_context(ctx, options));
+		}
+	}
+
+	MICROBENCH("tls/client_context/auto", [](state &st) {
+		tls_context(st, cs_impl::network::ssl_trust_mode::auto_mode);
+	});
+	MICROBENCH("tls/client_context/insecure", [](state &st) {
+		tls_context(st, cs_impl::network::ssl_trust_mode::insecure);
+	});
+}
+
+int main(int argc, char **argv)
+{
+	std::string filter, json_path, baseline_path;
+	double min_time = 0.5, tolerance = 10;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		auto value = [&]() -> std::string {
+			if (i + 1 >= argc) {
+				std::cerr << "missing value for " << arg << std::endl;
+				std::exit(2);
+			}
+			return argv[++i];
+		};
+		if (arg == "--filter")
+			filter = value();
+		else if (arg == "--min-time")
+			min_time = std::stod(value());
+		else if (arg == "--json")
+			json_path = value();
+		else if (arg == "--baseline")
+			baseline_path = value();
+		else if (arg == "--tolerance")
+			tolerance = std::stod(value());
+		else {
+			std::cerr << "usage: " << argv[0]
+			          << " [--filter <substring>] [--min-time <seconds>] [--json <file>]"
+			          << " [--baseline <file>] [--tolerance <pct>]" << std::endl;
+			return 2;
+		}
+	}
+	// Keep the shared io_context from stopping between benchmarks.
+	auto guard = asio::make_work_guard(cs_impl::network::get_io_context());
+	std::vector<microbench::result> results;
+	std::printf("%-36s %14s %14s %12s %12s\n", "benchmark", "iterations", "ns/op", "allocs/op", "bytes/op");
+	for (const auto &bm : microbench::registry()) {
+		if (!filter.empty() && bm.name.find(filter) == std::string::npos)
+			continue;
+		microbench::result r;
+		try {
+			r = microbench::run(bm, min_time);
+		}
+		catch (const std::exception &e) {
+			r.name = bm.name;
+			r.error = e.what();
+		}
+		if (!r.error.empty()) {
+			std::printf("%-36s ERROR: %s\n", r.name.c_str(), r.error.c_str());
+			continue;
+		}
+		std::printf("%-36s %14llu %14.1f %12.2f %12.1f\n", r.name.c_str(), static_cast<unsigned long long>(r.iterations),
+		            r.ns_per_op, r.allocs_per_op, r.bytes_per_op);
+		results.push_back(r);
+	}
+	if (!json_path.empty()) {
+		std::ofstream out(json_path);
+		microbench::write_json(out, results);
+	}
+	if (baseline_path.empty())
+		return 0;
+	int status = 0;
+	auto baseline = microbench::read_baseline(baseline_path);
+	std::printf("\n%-36s %12s %12s\n", "vs baseline", "ns/op", "allocs/op");
+	for (const auto &r : results) {
+		auto it = baseline.find(r.name);
+		if (it == baseline.end())
+			continue;
+		const auto &b = it->second;
+		double time_delta = b.ns_per_op > 0 ? (r.ns_per_op - b.ns_per_op) * 100 / b.ns_per_op : 0;
+		double alloc_delta = r.allocs_per_op - b.allocs_per_op;
+		bool regressed = time_delta > tolerance || alloc_delta > 0.5;
+		std::printf("%-36s %+11.1f%% %+12.2f%s\n", r.name.c_str(), time_delta, alloc_delta, regressed ? "  REGRESSION" : "");
+		if (regressed)
+			status = 1;
+	}
+	return status;
+}
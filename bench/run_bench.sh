@@ -0,0 +1,134 @@
+#!/usr/bin/env bash
+
+# Reproducible HTTP benchmark: starts bench/bench_server.csc in each
+# configuration, drives it with the native load generator (http_bench)
+# and writes all results, tagged with the current commit, as one JSON file.
+# Usage (from the repository root): bench/run_bench.sh [output.json]
+# Compare two runs: cs -i build/imports bench/compare.csc base.json new.json
+#
+# Environment:
+#   CS                 CovScript interpreter (cs)
+#   BENCH_IMPORTS      import path holding the extension under test
+#                      (build/imports); point it at a second build to
+#                      compare I/O backends, e.g. -DNETWORK_USE_IO_URING=ON
+#   HTTP_BENCH         load generator binary (built into build/ if unset)
+#   BENCH_DURATION     measured seconds per scenario (10)
+#   BENCH_WARMUP       warmup seconds per scenario (2)
+#   BENCH_CONNECTIONS  concurrent connections (64)
+#   BENCH_THREADS      load generator threads (2)
+#   BENCH_PORT         first port used by the servers (18480)
+#   BENCH_SLAVES       slave processes in the master/slave scenarios (4)
+#   BENCH_TLS_HOST, BENCH_TLS_PORT
+#                      TLS endpoint in front of a bench server (e.g. a
+#                      TLS-terminating proxy); TLS scenarios are skipped
+#                      when unset since http_server serves plain HTTP
+#   BENCH_SCENARIOS    space-separated subset of scenarios to run
+
+set -e
+
+CS="${CS:-cs}"
+DURATION=${BENCH_DURATION:-10}
+WARMUP=${BENCH_WARMUP:-2}
+CONNECTIONS=${BENCH_CONNECTIONS:-64}
+THREADS=${BENCH_THREADS:-2}
+PORT=${BENCH_PORT:-18480}
+SLAVES=${BENCH_SLAVES:-4}
+IMPORTS=${BENCH_IMPORTS:-build/imports}
+BACKEND=$("$CS" -i "$IMPORTS" bench/backend.csc 2>/dev/null || echo unknown)
+
+COMMIT=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+if [ -n "$(git status --porcelain --untracked-files=no 2>/dev/null)" ]; then
+    COMMIT="$COMMIT-dirty"
+fi
+OUTPUT=${1:-bench/results/$COMMIT.json}
+mkdir -p "$(dirname "$OUTPUT")"
+
+if [ -z "$HTTP_BENCH" ]; then
+    HTTP_BENCH=build/http_bench
+    if [ ! -x "$HTTP_BENCH" ] || [ bench/http_bench.cpp -nt "$HTTP_BENCH" ]; then
+        mkdir -p build
+        echo "Building $HTTP_BENCH"
+        ${CXX:-c++} -std=c++17 -O2 -Iinclude bench/http_bench.cpp -o "$HTTP_BENCH" -lssl -lcrypto -lpthread
+    fi
+fi
+
+SERVER_PID=""
+SERVER_PORT=""
+stop_server() {
+    if [ -n "$SERVER_PID" ]; then
+        kill "$SERVER_PID" 2>/dev/null || true
+        wait "$SERVER_PID" 2>/dev/null || true
+        # Slaves launched by a killed master would keep reconnecting
+        pkill -f "bench_server.csc slave $SERVER_PORT " 2>/dev/null || true
+        SERVER_PID=""
+    fi
+}
+trap stop_server EXIT
+
+# start_server <role> <port>
+start_server() {
+    BENCH_IMPORTS="$IMPORTS" "$CS" -i "$IMPORTS" bench/bench_server.csc "$1" "$2" $(( $2 + 1 )) "$SLAVES" >/dev/null 2>&1 &
+    SERVER_PID=$!
+    SERVER_PORT=$2
+    # Wait until the server answers (slaves need a moment to connect)
+    for _ in $(seq 1 100); do
+        if "$HTTP_BENCH" --port "$2" --path /hello --connections 1 --duration 0.2 --warmup 0 >/dev/null 2>&1; then
+            return 0
+        fi
+        sleep 0.2
+    done
+    echo "Server ($1) did not come up on port $2" >&2
+    return 1
+}
+
+RESULTS=()
+# scenario <name> <port> [http_bench options...]
+scenario() {
+    local name=$1 port=$2
+    shift 2
+    if [ -n "$BENCH_SCENARIOS" ] && [[ " $BENCH_SCENARIOS " != *" $name "* ]]; then
+        return 0
+    fi
+    echo "--- $name ---" >&2
+    local result
+    result=$("$HTTP_BENCH" --name "$name" --port "$port" --connections "$CONNECTIONS" --threads "$THREADS" \
+        --duration "$DURATION" --warmup "$WARMUP" "$@") || true
+    if [ -n "$result" ]; then
+        echo "$result" >&2
+        RESULTS+=("$result")
+    fi
+}
+
+start_server simple "$PORT"
+scenario simple_keepalive "$PORT" --path /hello
+scenario simple_close "$PORT" --path /hello --close
+scenario simple_pipelined "$PORT" --path /hello --pipeline 16
+scenario simple_large_response "$PORT" --path /large
+scenario simple_large_body "$PORT" --path /echo --method POST --body-size 1048576
+stop_server
+
+MASTER_PORT=$(( PORT + 10 ))
+start_server master "$MASTER_PORT"
+scenario master_keepalive "$MASTER_PORT" --path /hello
+scenario master_close "$MASTER_PORT" --path /hello --close
+scenario master_pipelined "$MASTER_PORT" --path /hello --pipeline 16
+scenario master_large_body "$MASTER_PORT" --path /echo --method POST --body-size 1048576
+stop_server
+
+if [ -n "$BENCH_TLS_HOST" ] && [ -n "$BENCH_TLS_PORT" ]; then
+    scenario tls_keepalive "$BENCH_TLS_PORT" --host "$BENCH_TLS_HOST" --tls --path /hello
+    scenario tls_close "$BENCH_TLS_PORT" --host "$BENCH_TLS_HOST" --tls --path /hello --close
+else
+    echo "SKIP: TLS scenarios (BENCH_TLS_HOST/BENCH_TLS_PORT not set)" >&2
+fi
+
+{
+    printf '{"commit":"%s","backend":"%s","date":"%s","host":"%s","scenarios":[' \
+        "$COMMIT" "$BACKEND" "$(date -u +%Y-%m-%dT%H:%M:%SZ)" "$(uname -srm)"
+    for i in "${!RESULTS[@]}"; do
+        [ "$i" -gt 0 ] && printf ','
+        printf '%s' "${RESULTS[$i]}"
+    done
+    printf ']}\n'
+} > "$OUTPUT"
+echo "Results written to $OUTPUT"
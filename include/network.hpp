@@ -42,15 +42,46 @@
 #undef PKCS7_SIGNER_INFO
 #undef OCSP_REQUEST
 #undef OCSP_RESPONSE
+#else
+#include <poll.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <netinet/tcp.h>
+#endif
+#ifdef __linux__
+#include <netinet/udp.h>
+// Older libc headers on newer kernels; unsupported kernels reject them at runtime
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
 #endif
 #include <string>
 #include <atomic>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <condition_variable>
 #include <vector>
+#include <map>
+#include <unordered_map>
+#include <deque>
+#include <list>
 #include <sstream>
+#include <fstream>
 #include <stdexcept>
 #include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <ctime>
+#include <cstdint>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#endif
 
 namespace cs_impl {
 	namespace network {
@@ -74,6 +105,487 @@ namespace cs_impl {
 			static asio::io_context instance;
 			return instance;
 		}
+		namespace metrics {
+			/*
+			 * Process-wide metrics registry. Counters and gauges are single
+			 * atomics; histograms are log-linear (HDR-style: 16 sub-buckets
+			 * per power of two, <= 6.25% relative error) over unsigned integer
+			 * samples, so recording never allocates or locks. Only creation
+			 * and export take the registry mutex; references handed out stay
+			 * valid for the life of the process.
+			 *
+			 * A name may carry a Prometheus label set, e.g.
+			 * http_requests_total{code="200"}; entries sharing the part before
+			 * '{' are exported as one metric family.
+			 */
+			class counter final {
+				std::atomic<std::uint64_t> v{0};
+
+			public:
+				void add(std::uint64_t n = 1) noexcept
+				{
+					v.fetch_add(n, std::memory_order_relaxed);
+				}
+				std::uint64_t value() const noexcept
+				{
+					return v.load(std::memory_order_relaxed);
+				}
+			};
+
+			class gauge final {
+				std::atomic<std::int64_t> v{0};
+
+			public:
+				void inc(std::int64_t n = 1) noexcept
+				{
+					v.fetch_add(n, std::memory_order_relaxed);
+				}
+				void dec(std::int64_t n = 1) noexcept
+				{
+					v.fetch_sub(n, std::memory_order_relaxed);
+				}
+				void set(std::int64_t n) noexcept
+				{
+					v.store(n, std::memory_order_relaxed);
+				}
+				std::int64_t value() const noexcept
+				{
+					return v.load(std::memory_order_relaxed);
+				}
+			};
+
+			class histogram final {
+				static constexpr unsigned sub_bits = 4;
+				static constexpr std::uint64_t sub_count = 1ull << sub_bits;
+				static constexpr std::size_t linear_count = 2 * sub_count;
+				static constexpr std::size_t bucket_count = linear_count + (64 - sub_bits - 1) * sub_count;
+
+				std::atomic<std::uint64_t> buckets[bucket_count] = {};
+				std::atomic<std::uint64_t> total{0};
+				std::atomic<std::uint64_t> sum_v{0};
+				std::atomic<std::uint64_t> min_v{UINT64_MAX};
+				std::atomic<std::uint64_t> max_v{0};
+
+				static unsigned log2_floor(std::uint64_t v) noexcept
+				{
+#if defined(__GNUC__) || defined(__clang__)
+					return 63u - static_cast<unsigned>(__builtin_clzll(v));
+#else
+					unsigned r = 0;
+					while (v >>= 1)
+						++r;
+					return r;
+#endif
+				}
+
+				static std::size_t index_of(std::uint64_t v) noexcept
+				{
+					if (v < linear_count)
+						return static_cast<std::size_t>(v);
+					unsigned e = log2_floor(v);
+					std::uint64_t sub = (v >> (e - sub_bits)) & (sub_count - 1);
+					return linear_count + (e - sub_bits - 1) * sub_count + static_cast<std::size_t>(sub);
+				}
+
+				// Largest value that maps to bucket idx.
+				static std::uint64_t upper_bound_of(std::size_t idx) noexcept
+				{
+					if (idx < linear_count)
+						return idx;
+					std::size_t off = idx - linear_count;
+					unsigned e = static_cast<unsigned>(off / sub_count) + sub_bits + 1;
+					std::uint64_t sub = off % sub_count;
+					std::uint64_t width = 1ull << (e - sub_bits);
+					return ((sub_count + sub) << (e - sub_bits)) + (width - 1);
+				}
+
+			public:
+				void record(std::uint64_t v) noexcept
+				{
+					buckets[index_of(v)].fetch_add(1, std::memory_order_relaxed);
+					total.fetch_add(1, std::memory_order_relaxed);
+					sum_v.fetch_add(v, std::memory_order_relaxed);
+					std::uint64_t cur = min_v.load(std::memory_order_relaxed);
+					while (v < cur && !min_v.compare_exchange_weak(cur, v, std::memory_order_relaxed))
+						;
+					cur = max_v.load(std::memory_order_relaxed);
+					while (v > cur && !max_v.compare_exchange_weak(cur, v, std::memory_order_relaxed))
+						;
+				}
+
+				std::uint64_t count() const noexcept
+				{
+					return total.load(std::memory_order_relaxed);
+				}
+
+				std::uint64_t sum() const noexcept
+				{
+					return sum_v.load(std::memory_order_relaxed);
+				}
+
+				std::uint64_t min() const noexcept
+				{
+					return count() == 0 ? 0 : min_v.load(std::memory_order_relaxed);
+				}
+
+				std::uint64_t max() const noexcept
+				{
+					return max_v.load(std::memory_order_relaxed);
+				}
+
+				// Value at quantile q (0..1), reported as the upper edge of its
+				// bucket and clamped to the observed maximum.
+				std::uint64_t percentile(double q) const noexcept
+				{
+					std::uint64_t n = count();
+					if (n == 0)
+						return 0;
+					if (q < 0)
+						q = 0;
+					if (q > 1)
+						q = 1;
+					std::uint64_t rank = static_cast<std::uint64_t>(q * static_cast<double>(n) + 0.5);
+					if (rank == 0)
+						rank = 1;
+					std::uint64_t seen = 0;
+					for (std::size_t i = 0; i < bucket_count; ++i) {
+						seen += buckets[i].load(std::memory_order_relaxed);
+						if (seen >= rank)
+							return (std::min)(upper_bound_of(i), max());
+					}
+					return max();
+				}
+			};
+
+			class registry final {
+				enum class kind { counter, gauge, histogram };
+				struct entry {
+					kind type;
+					std::string help;
+					std::unique_ptr<counter> c;
+					std::unique_ptr<gauge> g;
+					std::unique_ptr<histogram> h;
+				};
+
+				mutable std::mutex mtx;
+				std::map<std::string, entry> entries;
+				std::map<std::string, kind> family_types;
+
+				static std::string family_of(const std::string &name)
+				{
+					return name.substr(0, name.find('{'));
+				}
+
+				static void check_name(const std::string &name)
+				{
+					std::string family = family_of(name);
+					bool ok = !family.empty();
+					for (std::size_t i = 0; ok && i < family.size(); ++i) {
+						char ch = family[i];
+						bool alpha = (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_' || ch == ':';
+						ok = alpha || (i > 0 && ch >= '0' && ch <= '9');
+					}
+					if (ok && family.size() != name.size())
+						ok = name.back() == '}';
+					if (!ok)
+						throw std::runtime_error("Invalid metric name \"" + name + "\".");
+				}
+
+				entry &get(const std::string &name, kind type, const std::string &help)
+				{
+					std::lock_guard<std::mutex> lock(mtx);
+					auto it = entries.find(name);
+					if (it == entries.end()) {
+						check_name(name);
+						auto fam = family_types.emplace(family_of(name), type).first;
+						if (fam->second != type)
+							throw std::runtime_error("Metric family \"" + fam->first + "\" is already registered with another type.");
+						entry e;
+						e.type = type;
+						e.help = help;
+						if (type == kind::counter)
+							e.c = std::make_unique<counter>();
+						else if (type == kind::gauge)
+							e.g = std::make_unique<gauge>();
+						else
+							e.h = std::make_unique<histogram>();
+						it = entries.emplace(name, std::move(e)).first;
+					}
+					else if (it->second.type != type)
+						throw std::runtime_error("Metric \"" + name + "\" is already registered with another type.");
+					return it->second;
+				}
+
+				// Joins the entry's own labels with an extra one for export.
+				static std::string with_label(const std::string &name, const std::string &suffix, const std::string &label)
+				{
+					std::string family = family_of(name);
+					std::string labels = family.size() == name.size() ? "" : name.substr(family.size() + 1, name.size() - family.size() - 2);
+					if (!label.empty())
+						labels = labels.empty() ? label : labels + "," + label;
+					return labels.empty() ? family + suffix : family + suffix + "{" + labels + "}";
+				}
+
+			public:
+				counter &get_counter(const std::string &name, const std::string &help = "")
+				{
+					return *get(name, kind::counter, help).c;
+				}
+
+				gauge &get_gauge(const std::string &name, const std::string &help = "")
+				{
+					return *get(name, kind::gauge, help).g;
+				}
+
+				histogram &get_histogram(const std::string &name, const std::string &help = "")
+				{
+					return *get(name, kind::histogram, help).h;
+				}
+
+				void set_help(const std::string &name, const std::string &help)
+				{
+					std::lock_guard<std::mutex> lock(mtx);
+					auto it = entries.find(name);
+					if (it == entries.end())
+						throw std::runtime_error("Metric \"" + name + "\" is not registered.");
+					it->second.help = help;
+				}
+
+				// Visits every entry in name order; exactly one pointer is set.
+				template <typename F>
+				void each(F &&fn) const
+				{
+					std::lock_guard<std::mutex> lock(mtx);
+					for (auto &it : entries)
+						fn(it.first, it.second.c.get(), it.second.g.get(), it.second.h.get());
+				}
+
+				// Prometheus text exposition format 0.0.4. Histograms are
+				// exported as summaries (fixed quantiles plus _sum/_count) so
+				// the series set does not depend on which buckets are populated.
+				std::string prometheus() const
+				{
+					static const char *quantiles[] = {"0.5", "0.9", "0.99", "0.999"};
+					std::lock_guard<std::mutex> lock(mtx);
+					std::map<std::string, std::vector<const std::pair<const std::string, entry> *>> families;
+					for (auto &it : entries)
+						families[family_of(it.first)].push_back(&it);
+					std::string out;
+					for (auto &fam : families) {
+						const entry &first = fam.second.front()->second;
+						std::string help;
+						for (auto *it : fam.second) {
+							if (!it->second.help.empty()) {
+								help = it->second.help;
+								break;
+							}
+						}
+						if (!help.empty()) {
+							out += "# HELP " + fam.first + " ";
+							for (char ch : help)
+								out += ch == '\n' ? "\\n" : ch == '\\' ? "\\\\" : std::string(1, ch);
+							out += "\n";
+						}
+						out += "# TYPE " + fam.first + (first.type == kind::counter ? " counter\n" : first.type == kind::gauge ? " gauge\n" : " summary\n");
+						for (auto *it : fam.second) {
+							const std::string &name = it->first;
+							const entry &e = it->second;
+							if (e.c)
+								out += name + " " + std::to_string(e.c->value()) + "\n";
+							else if (e.g)
+								out += name + " " + std::to_string(e.g->value()) + "\n";
+							else if (e.h) {
+								for (const char *q : quantiles)
+									out += with_label(name, "", std::string("quantile=\"") + q + "\"") + " " + std::to_string(e.h->percentile(std::atof(q))) + "\n";
+								out += with_label(name, "_sum", "") + " " + std::to_string(e.h->sum()) + "\n";
+								out += with_label(name, "_count", "") + " " + std::to_string(e.h->count()) + "\n";
+							}
+						}
+					}
+					return out;
+				}
+			};
+
+			static registry &get_registry()
+			{
+				static registry instance;
+				return instance;
+			}
+
+			// Metrics fed by the extension itself.
+			struct builtin_metrics {
+				gauge &tcp_sockets_open = get_registry().get_gauge("network_tcp_sockets_open", "TCP sockets currently allocated.");
+				gauge &udp_sockets_open = get_registry().get_gauge("network_udp_sockets_open", "UDP sockets currently allocated.");
+				gauge &async_pending = get_registry().get_gauge("network_async_pending", "Asynchronous operations waiting for their completion handler.");
+				counter &tcp_accepts = get_registry().get_counter("network_tcp_accepts_total", "Accepted TCP connections.");
+				counter &tcp_connects = get_registry().get_counter("network_tcp_connects_total", "Established outgoing TCP connections.");
+				counter &tcp_bytes_read = get_registry().get_counter("network_tcp_bytes_read_total", "Bytes read from TCP sockets.");
+				counter &tcp_bytes_written = get_registry().get_counter("network_tcp_bytes_written_total", "Bytes written to TCP sockets.");
+				counter &udp_bytes_received = get_registry().get_counter("network_udp_bytes_received_total", "Bytes received on UDP sockets.");
+				counter &udp_bytes_sent = get_registry().get_counter("network_udp_bytes_sent_total", "Bytes sent on UDP sockets.");
+				counter &async_errors = get_registry().get_counter("network_async_errors_total", "Asynchronous operations completed with an error.");
+				counter &tls_handshakes = get_registry().get_counter("network_tls_handshakes_total", "Completed TLS client handshakes.");
+				counter &tls_handshake_failures = get_registry().get_counter("network_tls_handshake_failures_total", "Failed TLS client handshakes.");
+				histogram &tls_handshake_us = get_registry().get_histogram("network_tls_handshake_microseconds", "TLS client handshake duration.");
+				counter &dns_cache_hits = get_registry().get_counter("network_dns_cache_hits_total", "Name resolutions answered from the resolve cache.");
+				counter &dns_cache_misses = get_registry().get_counter("network_dns_cache_misses_total", "Name resolutions sent to the system resolver.");
+				counter &tcp_accept_batches = get_registry().get_counter("network_tcp_accept_batches_total", "Readiness events drained by batch accepts.");
+				gauge &tcp_listen_overflows = get_registry().get_gauge("network_tcp_listen_overflows", "Host-wide accept queue overflows (TcpExt ListenOverflows), sampled at export.");
+				gauge &tcp_listen_drops = get_registry().get_gauge("network_tcp_listen_drops", "Host-wide SYNs dropped at listeners (TcpExt ListenDrops), sampled at export.");
+			};
+
+			static builtin_metrics &builtin()
+			{
+				static builtin_metrics instance;
+				return instance;
+			}
+
+			static std::uint64_t elapsed_us(std::chrono::steady_clock::time_point since)
+			{
+				return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+				                                      std::chrono::steady_clock::now() - since).count());
+			}
+		}
+
+		namespace dns {
+			/*
+			 * Process-wide cache of name resolutions, shared by the blocking
+			 * tcp.resolve/udp.resolve and async.resolve. getaddrinfo does not
+			 * report record TTLs, so answers live for a fixed positive TTL
+			 * and definite failures (unknown host or service) for a shorter
+			 * negative TTL; transient failures are not cached. When full, the
+			 * entry closest to expiry is evicted.
+			 */
+			class resolve_cache final {
+			public:
+				struct entry {
+					std::vector<std::pair<asio::ip::address, unsigned short>> addresses;
+					asio::error_code ec;
+					std::chrono::steady_clock::time_point expires;
+				};
+
+			private:
+				mutable std::mutex mutex;
+				std::unordered_map<std::string, entry> entries;
+				std::chrono::milliseconds positive_ttl{60000};
+				std::chrono::milliseconds negative_ttl{5000};
+				std::size_t max_entries = 1024;
+
+			public:
+				static std::string key(char protocol, const std::string &host, const std::string &service)
+				{
+					std::string k;
+					k.reserve(host.size() + service.size() + 2);
+					k.push_back(protocol);
+					k.append(host);
+					k.push_back('\0');
+					k.append(service);
+					return k;
+				}
+
+				static bool is_definite_failure(const asio::error_code &ec)
+				{
+					return ec == asio::error::host_not_found || ec == asio::error::service_not_found || ec == asio::error::no_data;
+				}
+
+				void configure(std::chrono::milliseconds positive, std::chrono::milliseconds negative, std::size_t capacity)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					positive_ttl = positive;
+					negative_ttl = negative;
+					max_entries = capacity;
+					if (max_entries == 0)
+						entries.clear();
+				}
+
+				bool lookup(const std::string &k, entry &out)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					auto it = entries.find(k);
+					if (it == entries.end() || it->second.expires <= std::chrono::steady_clock::now()) {
+						if (it != entries.end())
+							entries.erase(it);
+						metrics::builtin().dns_cache_misses.add();
+						return false;
+					}
+					out = it->second;
+					metrics::builtin().dns_cache_hits.add();
+					return true;
+				}
+
+				void store(const std::string &k, std::vector<std::pair<asio::ip::address, unsigned short>> addresses, const asio::error_code &ec)
+				{
+					if (ec && !is_definite_failure(ec))
+						return;
+					std::lock_guard<std::mutex> lock(mutex);
+					auto ttl = ec ? negative_ttl : positive_ttl;
+					if (max_entries == 0 || ttl.count() <= 0)
+						return;
+					auto now = std::chrono::steady_clock::now();
+					if (entries.size() >= max_entries && entries.find(k) == entries.end()) {
+						auto victim = entries.begin();
+						for (auto it = entries.begin(); it != entries.end(); ++it) {
+							if (it->second.expires <= now) {
+								victim = it;
+								break;
+							}
+							if (it->second.expires < victim->second.expires)
+								victim = it;
+						}
+						entries.erase(victim);
+					}
+					entries[k] = entry{std::move(addresses), ec, now + ttl};
+				}
+
+				void clear()
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					entries.clear();
+				}
+
+				std::size_t size() const
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					return entries.size();
+				}
+			};
+
+			static resolve_cache &cache()
+			{
+				static resolve_cache instance;
+				return instance;
+			}
+
+			template <typename Results>
+			std::vector<std::pair<asio::ip::address, unsigned short>> addresses_of(const Results &results)
+			{
+				std::vector<std::pair<asio::ip::address, unsigned short>> out;
+				for (auto &r : results)
+					out.emplace_back(r.endpoint().address(), r.endpoint().port());
+				return out;
+			}
+
+			// Blocking resolve through the cache; throws asio::system_error
+			template <typename Protocol>
+			std::vector<std::pair<asio::ip::address, unsigned short>> resolve(char protocol, const std::string &host, const std::string &service)
+			{
+				auto k = resolve_cache::key(protocol, host, service);
+				resolve_cache::entry hit;
+				if (cache().lookup(k, hit)) {
+					if (hit.ec)
+						throw asio::system_error(hit.ec);
+					return hit.addresses;
+				}
+				typename Protocol::resolver resolver(get_io_context());
+				asio::error_code ec;
+				auto results = resolver.resolve(host, service, ec);
+				auto addresses = ec ? std::vector<std::pair<asio::ip::address, unsigned short>>() : addresses_of(results);
+				cache().store(k, addresses, ec);
+				if (ec)
+					throw asio::system_error(ec);
+				return addresses;
+			}
+		}
 		namespace detail {
 			static std::string &last_tls_trust_report_slot()
 			{
@@ -369,6 +881,115 @@ namespace cs_impl {
 				return std::move(tcp::acceptor(get_io_context(), ep));
 			}
 
+			// As above with an explicit listen() backlog; the kernel caps it
+			// at net.core.somaxconn
+			tcp::acceptor acceptor(const tcp::endpoint &ep, int backlog)
+			{
+				tcp::acceptor a(get_io_context());
+				a.open(ep.protocol());
+				a.set_option(tcp::acceptor::reuse_address(true));
+				a.bind(ep);
+				a.listen(backlog);
+				return a;
+			}
+
+			// Adopt a listening socket inherited from the parent process (e.g. a
+			// server re-executed for a graceful reload). The address family is
+			// read back from the socket itself; anything but a listening stream
+			// socket is rejected.
+			tcp::acceptor acceptor_from_handle(tcp::acceptor::native_handle_type handle)
+			{
+				asio::detail::sockaddr_storage_type addr{};
+				std::size_t addr_len = sizeof(addr);
+				asio::error_code ec;
+				asio::detail::socket_ops::getsockname(handle, reinterpret_cast<asio::detail::socket_addr_type *>(&addr), &addr_len, ec);
+				if (ec)
+					throw std::runtime_error("Invalid listening socket handle: " + ec.message());
+				// Only a listening stream socket can be adopted as an acceptor
+				int type = 0, listening = 0;
+				std::size_t opt_len = sizeof(type);
+				asio::detail::socket_ops::getsockopt(handle, 0, SOL_SOCKET, SO_TYPE, &type, &opt_len, ec);
+				if (ec)
+					throw std::runtime_error("Invalid listening socket handle: " + ec.message());
+				if (type != SOCK_STREAM)
+					throw std::runtime_error("Invalid listening socket handle: not a stream socket.");
+				opt_len = sizeof(listening);
+				asio::detail::socket_ops::getsockopt(handle, 0, SOL_SOCKET, SO_ACCEPTCONN, &listening, &opt_len, ec);
+				if (ec)
+					throw std::runtime_error("Invalid listening socket handle: " + ec.message());
+				if (listening == 0)
+					throw std::runtime_error("Invalid listening socket handle: socket is not listening.");
+				tcp::acceptor a(get_io_context());
+				a.assign(addr.ss_family == AF_INET6 ? tcp::v6() : tcp::v4(), handle);
+				return a;
+			}
+
+			// Control whether the listening socket survives exec into a child
+			// process (FD_CLOEXEC on POSIX, HANDLE_FLAG_INHERIT on Windows).
+			void set_inheritable(tcp::acceptor &a, bool value)
+			{
+#ifdef _WIN32
+				if (!::SetHandleInformation(reinterpret_cast<HANDLE>(a.native_handle()), HANDLE_FLAG_INHERIT, value ? HANDLE_FLAG_INHERIT : 0))
+					throw std::runtime_error("Failed to change handle inheritance.");
+#else
+				int flags = ::fcntl(a.native_handle(), F_GETFD);
+				if (flags == -1 || ::fcntl(a.native_handle(), F_SETFD, value ? (flags & ~FD_CLOEXEC) : (flags | FD_CLOEXEC)) == -1)
+					throw std::runtime_error("Failed to change descriptor inheritance.");
+#endif
+			}
+
+			/*
+			 * Integer options asio does not wrap. Callers guard each option
+			 * with its macro; false means the kernel rejected the value.
+			 */
+			template <typename handle_t>
+			bool set_native_option(handle_t handle, int level, int name, int value)
+			{
+				return ::setsockopt(handle, level, name, reinterpret_cast<const char *>(&value), sizeof(value)) == 0;
+			}
+
+			// TCP Fast Open on a listener: qlen bounds pending TFO requests,
+			// 0 disables it
+			bool set_fast_open(tcp::acceptor &a, int qlen)
+			{
+#ifdef TCP_FASTOPEN
+				return set_native_option(a.native_handle(), IPPROTO_TCP, TCP_FASTOPEN, qlen);
+#else
+				(void)a;
+				(void)qlen;
+				return false;
+#endif
+			}
+
+			// Wake accept() only once data arrives, waiting at most seconds
+			bool set_defer_accept(tcp::acceptor &a, int seconds)
+			{
+#ifdef TCP_DEFER_ACCEPT
+				return set_native_option(a.native_handle(), IPPROTO_TCP, TCP_DEFER_ACCEPT, seconds);
+#else
+				(void)a;
+				(void)seconds;
+				return false;
+#endif
+			}
+
+			// Subset of the kernel's TCP_INFO used for latency diagnosis
+			struct connection_info {
+				unsigned state = 0;
+				unsigned retransmits = 0;
+				std::uint64_t rtt_us = 0;
+				std::uint64_t rttvar_us = 0;
+				std::uint64_t rto_us = 0;
+				std::uint64_t snd_cwnd = 0;
+				std::uint64_t snd_ssthresh = 0;
+				std::uint64_t snd_mss = 0;
+				std::uint64_t rcv_mss = 0;
+				std::uint64_t unacked = 0;
+				std::uint64_t lost = 0;
+				std::uint64_t total_retrans = 0;
+				std::uint64_t pmtu = 0;
+			};
+
 			tcp::endpoint endpoint(const std::string &address, unsigned short port)
 			{
 				return std::move(tcp::endpoint(asio::ip::make_address(address), port));
@@ -376,12 +997,10 @@ namespace cs_impl {
 
 			cs::var resolve(const std::string &host, const std::string &service)
 			{
-				tcp::resolver resolver(get_io_context());
-				tcp::resolver::results_type results = resolver.resolve(host, service);
 				cs::var ret = cs::var::make<cs::array>();
 				cs::array &arr = ret.val<cs::array>();
-				for (auto &ep : results)
-					arr.push_back(cs::var::make<tcp::endpoint>(ep));
+				for (auto &addr : dns::resolve<tcp>('t', host, service))
+					arr.push_back(cs::var::make<tcp::endpoint>(addr.first, addr.second));
 				return ret;
 			}
 
@@ -546,10 +1165,18 @@ namespace cs_impl {
 				// Counts active I/O jobs; exclusive operations reserve one slot.
 				std::atomic<std::size_t> async_jobs{0};
 
-				socket() : sock(get_io_context()), tls_strand(asio::make_strand(get_io_context())) {}
+				socket() : sock(get_io_context()), tls_strand(asio::make_strand(get_io_context()))
+				{
+					metrics::builtin().tcp_sockets_open.inc();
+				}
 
 				socket(const socket &) = delete;
 
+				~socket()
+				{
+					metrics::builtin().tcp_sockets_open.dec();
+				}
+
 				tcp::socket &get_raw()
 				{
 					return sock;
@@ -560,6 +1187,7 @@ namespace cs_impl {
 					scoped_exclusive_operation operation(
 					    *this, "Cannot connect while socket I/O is pending.");
 					sock.connect(ep);
+					metrics::builtin().tcp_connects.add();
 				}
 
 				void connect_ssl(const std::string &host, const ssl_options &options = ssl_options())
@@ -572,14 +1200,19 @@ namespace cs_impl {
 						end_tls_handshake();
 						throw;
 					}
+					auto &stats = metrics::builtin();
+					auto started = std::chrono::steady_clock::now();
 					try {
 						tls_stream->handshake(asio::ssl::stream_base::client);
 					}
 					catch (...) {
+						stats.tls_handshake_failures.add();
 						clear_ssl(false);
 						end_tls_handshake();
 						throw;
 					}
+					stats.tls_handshakes.add();
+					stats.tls_handshake_us.record(metrics::elapsed_us(started));
 					end_tls_handshake();
 				}
 
@@ -688,6 +1321,7 @@ namespace cs_impl {
 					scoped_exclusive_operation operation(
 					    *this, "Cannot accept into a socket while socket I/O is pending.");
 					a.accept(sock);
+					metrics::builtin().tcp_accepts.add();
 				}
 
 				bool is_open()
@@ -701,6 +1335,134 @@ namespace cs_impl {
 					sock.set_option(std::forward<opt_t>(opt));
 				}
 
+				template <typename opt_t>
+				opt_t get_option()
+				{
+					opt_t opt;
+					sock.get_option(opt);
+					return opt;
+				}
+
+				/*
+				 * Latency tuning options. Each returns false where the
+				 * platform lacks the option or the kernel rejects the value.
+				 */
+				bool set_opt_quick_ack(bool enable)
+				{
+#ifdef TCP_QUICKACK
+					return set_native_option(sock.native_handle(), IPPROTO_TCP, TCP_QUICKACK, enable ? 1 : 0);
+#else
+					(void)enable;
+					return false;
+#endif
+				}
+
+				// Hold partial frames until uncorked (TCP_NOPUSH on BSD)
+				bool set_opt_cork(bool enable)
+				{
+#if defined(TCP_CORK)
+					return set_native_option(sock.native_handle(), IPPROTO_TCP, TCP_CORK, enable ? 1 : 0);
+#elif defined(TCP_NOPUSH)
+					return set_native_option(sock.native_handle(), IPPROTO_TCP, TCP_NOPUSH, enable ? 1 : 0);
+#else
+					(void)enable;
+					return false;
+#endif
+				}
+
+				bool set_opt_notsent_lowat(int bytes)
+				{
+#ifdef TCP_NOTSENT_LOWAT
+					return set_native_option(sock.native_handle(), IPPROTO_TCP, TCP_NOTSENT_LOWAT, bytes);
+#else
+					(void)bytes;
+					return false;
+#endif
+				}
+
+				// Probe timing once SO_KEEPALIVE is on (TCP_KEEPALIVE on macOS)
+				bool set_opt_keep_alive_params(int idle_s, int interval_s, int count)
+				{
+#if defined(TCP_KEEPIDLE)
+					const int idle_name = TCP_KEEPIDLE;
+#elif defined(TCP_KEEPALIVE)
+					const int idle_name = TCP_KEEPALIVE;
+#endif
+#if (defined(TCP_KEEPIDLE) || defined(TCP_KEEPALIVE)) && defined(TCP_KEEPINTVL) && defined(TCP_KEEPCNT)
+					return set_native_option(sock.native_handle(), IPPROTO_TCP, idle_name, idle_s) &&
+					       set_native_option(sock.native_handle(), IPPROTO_TCP, TCP_KEEPINTVL, interval_s) &&
+					       set_native_option(sock.native_handle(), IPPROTO_TCP, TCP_KEEPCNT, count);
+#else
+					(void)idle_s;
+					(void)interval_s;
+					(void)count;
+					return false;
+#endif
+				}
+
+				// Abort the connection when sent data stays unacknowledged for ms
+				bool set_opt_user_timeout(unsigned ms)
+				{
+#ifdef TCP_USER_TIMEOUT
+					return set_native_option(sock.native_handle(), IPPROTO_TCP, TCP_USER_TIMEOUT, static_cast<int>(ms));
+#else
+					(void)ms;
+					return false;
+#endif
+				}
+
+				// Busy-poll the device queue for up to us microseconds on
+				// blocking receives; raising it past net.core.busy_read
+				// needs CAP_NET_ADMIN
+				bool set_opt_busy_poll(int us)
+				{
+#if defined(__linux__) && defined(SO_BUSY_POLL)
+					return set_native_option(sock.native_handle(), SOL_SOCKET, SO_BUSY_POLL, us);
+#else
+					(void)us;
+					return false;
+#endif
+				}
+
+				// Client side of TCP Fast Open: connect() defers the SYN to
+				// the first write so the data rides in it
+				bool set_opt_fast_open_connect(bool enable)
+				{
+#ifdef TCP_FASTOPEN_CONNECT
+					return set_native_option(sock.native_handle(), IPPROTO_TCP, TCP_FASTOPEN_CONNECT, enable ? 1 : 0);
+#else
+					(void)enable;
+					return false;
+#endif
+				}
+
+				connection_info get_connection_info()
+				{
+#if defined(__linux__) && defined(TCP_INFO)
+					struct ::tcp_info info {};
+					socklen_t len = sizeof(info);
+					if (::getsockopt(sock.native_handle(), IPPROTO_TCP, TCP_INFO, &info, &len) != 0)
+						throw asio::system_error(asio::error_code(errno, asio::system_category()));
+					connection_info out;
+					out.state = info.tcpi_state;
+					out.retransmits = info.tcpi_retransmits;
+					out.rtt_us = info.tcpi_rtt;
+					out.rttvar_us = info.tcpi_rttvar;
+					out.rto_us = info.tcpi_rto;
+					out.snd_cwnd = info.tcpi_snd_cwnd;
+					out.snd_ssthresh = info.tcpi_snd_ssthresh;
+					out.snd_mss = info.tcpi_snd_mss;
+					out.rcv_mss = info.tcpi_rcv_mss;
+					out.unacked = info.tcpi_unacked;
+					out.lost = info.tcpi_lost;
+					out.total_retrans = info.tcpi_total_retrans;
+					out.pmtu = info.tcpi_pmtu;
+					return out;
+#else
+					throw std::runtime_error("TCP_INFO is not supported on this platform.");
+#endif
+				}
+
 				std::size_t available()
 				{
 					if (!try_begin_io_job(io_direction::read))
@@ -756,6 +1518,7 @@ namespace cs_impl {
 					std::size_t actually = tls_stream
 					                       ? tls_stream->read_some(asio::buffer(buff))
 					                       : sock.read_some(asio::buffer(buff));
+					metrics::builtin().tcp_bytes_read.add(actually);
 					return std::string(buff.data(), actually);
 				}
 
@@ -766,16 +1529,18 @@ namespace cs_impl {
 					std::size_t n = tls_stream
 					                ? asio::read(*tls_stream, asio::buffer(buff))
 					                : asio::read(sock, asio::buffer(buff));
+					metrics::builtin().tcp_bytes_read.add(n);
 					return std::string(buff.data(), n);
 				}
 
 				std::size_t send(const std::string &s)
 				{
 					scoped_io_job job(*this, io_direction::write);
-					if (tls_stream)
-						return tls_stream->write_some(asio::buffer(s));
-					else
-						return sock.write_some(asio::buffer(s));
+					std::size_t n = tls_stream
+					                ? tls_stream->write_some(asio::buffer(s))
+					                : sock.write_some(asio::buffer(s));
+					metrics::builtin().tcp_bytes_written.add(n);
+					return n;
 				}
 
 				void write(const std::string &s)
@@ -785,6 +1550,7 @@ namespace cs_impl {
 						asio::write(*tls_stream, asio::buffer(s));
 					else
 						asio::write(sock, asio::buffer(s));
+					metrics::builtin().tcp_bytes_written.add(s.size());
 				}
 
 				void shutdown()
@@ -812,26 +1578,140 @@ namespace cs_impl {
 					return sock.remote_endpoint();
 				}
 			};
-		}
-		namespace udp {
-			using asio::ip::udp;
 
-			udp::endpoint endpoint(const std::string &address, unsigned short port)
+			/*
+			 * Accept up to max_count connections already waiting in the
+			 * listen queue, stopping at EAGAIN. The listener must be in
+			 * native non-blocking mode; on Linux accept4 marks each new
+			 * descriptor close-on-exec in the same call. Connections reset
+			 * before they were accepted are skipped. ec is set only when
+			 * nothing was accepted.
+			 */
+			std::size_t accept_ready(tcp::acceptor &a, std::size_t max_count, std::vector<std::shared_ptr<socket>> &out, asio::error_code &ec)
 			{
-				return std::move(udp::endpoint(asio::ip::make_address(address), port));
+				auto protocol = a.local_endpoint().protocol();
+				std::size_t accepted = 0;
+				asio::error_code accept_ec;
+				while (accepted < max_count) {
+#ifdef __linux__
+					int fd = ::accept4(a.native_handle(), nullptr, nullptr, SOCK_CLOEXEC);
+					if (fd < 0)
+						accept_ec = asio::error_code(errno, asio::system_category());
+					else
+						accept_ec.clear();
+#else
+					auto fd = asio::detail::socket_ops::accept(a.native_handle(), nullptr, nullptr, accept_ec);
+#endif
+					if (fd == asio::detail::invalid_socket) {
+						if (accept_ec == asio::error::interrupted || accept_ec == asio::error::connection_aborted)
+							continue;
+#ifdef EPROTO
+						if (accept_ec.value() == EPROTO)
+							continue;
+#endif
+						if (accept_ec == asio::error::would_block || accept_ec == asio::error::try_again)
+							accept_ec.clear();
+						break;
+					}
+					auto s = std::make_shared<socket>();
+					s->get_raw().assign(protocol, fd, accept_ec);
+					if (accept_ec) {
+						asio::error_code ignored;
+						asio::detail::socket_ops::state_type state = 0;
+						asio::detail::socket_ops::close(fd, state, true, ignored);
+						break;
+					}
+					out.push_back(std::move(s));
+					++accepted;
+				}
+				if (accepted > 0)
+					metrics::builtin().tcp_accepts.add(accepted);
+				else
+					ec = accept_ec;
+				return accepted;
 			}
 
-			cs::var resolve(const std::string &host, const std::string &service)
+			// Accept queue of one listener, from TCP_INFO on Linux: queued
+			// connections waiting for accept() and the effective backlog
+			struct listen_queue {
+				std::uint64_t queued = 0;
+				std::uint64_t backlog = 0;
+			};
+
+			listen_queue get_listen_queue(tcp::acceptor &a)
 			{
-				udp::resolver resolver(get_io_context());
-				udp::resolver::results_type results = resolver.resolve(host, service);
-				cs::var ret = cs::var::make<cs::array>();
-				cs::array &arr = ret.val<cs::array>();
-				for (auto &ep : results)
-					arr.push_back(cs::var::make<udp::endpoint>(ep));
-				return ret;
+#if defined(__linux__) && defined(TCP_INFO)
+				struct ::tcp_info info {};
+				socklen_t len = sizeof(info);
+				if (::getsockopt(a.native_handle(), IPPROTO_TCP, TCP_INFO, &info, &len) != 0)
+					throw asio::system_error(asio::error_code(errno, asio::system_category()));
+				listen_queue out;
+				out.queued = info.tcpi_unacked;
+				out.backlog = info.tcpi_sacked;
+				return out;
+#else
+				(void)a;
+				throw std::runtime_error("Listen queue statistics are not supported on this platform.");
+#endif
 			}
 
+			// Host-wide accept queue overflows and dropped SYNs, the
+			// TcpExt ListenOverflows and ListenDrops counters of
+			// /proc/net/netstat. False where they are not available.
+			bool read_listen_counters(std::uint64_t &overflows, std::uint64_t &drops)
+			{
+#ifdef __linux__
+				std::ifstream in("/proc/net/netstat");
+				std::string names, values;
+				while (std::getline(in, names) && std::getline(in, values)) {
+					if (names.compare(0, 7, "TcpExt:") != 0)
+						continue;
+					std::istringstream name_in(names), value_in(values);
+					std::string name, value;
+					bool found = false;
+					while (name_in >> name && value_in >> value) {
+						if (name == "ListenOverflows") {
+							overflows = std::strtoull(value.c_str(), nullptr, 10);
+							found = true;
+						}
+						else if (name == "ListenDrops") {
+							drops = std::strtoull(value.c_str(), nullptr, 10);
+							found = true;
+						}
+					}
+					return found;
+				}
+				return false;
+#else
+				(void)overflows;
+				(void)drops;
+				return false;
+#endif
+			}
+		}
+		namespace udp {
+			using asio::ip::udp;
+
+			udp::endpoint endpoint(const std::string &address, unsigned short port)
+			{
+				return std::move(udp::endpoint(asio::ip::make_address(address), port));
+			}
+
+			cs::var resolve(const std::string &host, const std::string &service)
+			{
+				auto addresses = dns::resolve<udp>('u', host, service);
+				cs::var ret = cs::var::make<cs::array>();
+				cs::array &arr = ret.val<cs::array>();
+				for (auto &addr : addresses)
+					arr.push_back(cs::var::make<udp::endpoint>(addr.first, addr.second));
+				return ret;
+			}
+
+			struct datagram {
+				std::string data;
+				udp::endpoint endpoint;
+			};
+
 			class socket final {
 				udp::socket sock;
 				std::atomic<bool> exclusive_operation{false};
@@ -942,10 +1822,18 @@ namespace cs_impl {
 			public:
 				std::atomic<std::size_t> async_jobs{0};
 
-				socket() : sock(get_io_context()) {}
+				socket() : sock(get_io_context())
+				{
+					metrics::builtin().udp_sockets_open.inc();
+				}
 
 				socket(const socket &) = delete;
 
+				~socket()
+				{
+					metrics::builtin().udp_sockets_open.dec();
+				}
+
 				udp::socket &get_raw()
 				{
 					return sock;
@@ -1005,6 +1893,63 @@ namespace cs_impl {
 					sock.set_option(std::forward<opt_t>(opt));
 				}
 
+				template <typename opt_t>
+				opt_t get_option()
+				{
+					opt_t opt;
+					sock.get_option(opt);
+					return opt;
+				}
+
+				/*
+				 * Multicast membership. iface selects the local interface: an
+				 * IPv4 address for IPv4 groups, an interface name or index for
+				 * IPv6 groups; empty lets the kernel choose.
+				 */
+				void join_group(const std::string &group, const std::string &iface)
+				{
+					update_membership(group, iface, true);
+				}
+
+				void leave_group(const std::string &group, const std::string &iface)
+				{
+					update_membership(group, iface, false);
+				}
+
+				// Outbound interface of multicast sends, same iface format
+				void set_multicast_interface(const std::string &iface)
+				{
+					if (is_v6())
+						sock.set_option(asio::ip::multicast::outbound_interface(interface_index(iface)));
+					else
+						sock.set_option(asio::ip::multicast::outbound_interface(iface.empty() ? asio::ip::address_v4::any() : asio::ip::make_address_v4(iface)));
+				}
+
+				/*
+				 * SO_RXQ_OVFL: the kernel attaches its count of datagrams dropped
+				 * for this socket to every receive; batch receives record the
+				 * latest value, read by dropped(). Returns false where the
+				 * option is not available.
+				 */
+				bool set_opt_rxq_ovfl(bool enable)
+				{
+#if defined(__linux__) && defined(SO_RXQ_OVFL)
+					int value = enable ? 1 : 0;
+					if (::setsockopt(sock.native_handle(), SOL_SOCKET, SO_RXQ_OVFL, &value, sizeof(value)) != 0)
+						return false;
+					rxq_ovfl_enabled = enable;
+					return true;
+#else
+					(void)enable;
+					return false;
+#endif
+				}
+
+				std::uint64_t dropped() const
+				{
+					return rx_dropped.load(std::memory_order_relaxed);
+				}
+
 				std::size_t available()
 				{
 					if (!try_begin_io_job(io_direction::read))
@@ -1024,13 +1969,14 @@ namespace cs_impl {
 					scoped_io_job job(*this, io_direction::read);
 					std::vector<char> buff(maximum);
 					std::size_t actually = sock.receive_from(asio::buffer(buff), ep);
+					metrics::builtin().udp_bytes_received.add(actually);
 					return std::string(buff.data(), actually);
 				}
 
 				void send_to(const std::string &s, const udp::endpoint &ep)
 				{
 					scoped_io_job job(*this, io_direction::write);
-					sock.send_to(asio::buffer(s), ep);
+					metrics::builtin().udp_bytes_sent.add(sock.send_to(asio::buffer(s), ep));
 				}
 
 				udp::endpoint local_endpoint()
@@ -1042,6 +1988,1271 @@ namespace cs_impl {
 				{
 					return sock.remote_endpoint();
 				}
+
+				/*
+				 * Batched datagram I/O. receive_batch drains up to max_count
+				 * queued datagrams (each truncated to max_size bytes) in one
+				 * call, waiting up to timeout_ms (< 0: forever, 0: not at all)
+				 * for the first one; send_batch sends a batch in order. Linux
+				 * uses recvmmsg/sendmmsg, one system call per batch; other
+				 * platforms loop over non-blocking receive_from/send_to. The
+				 * receive buffers are kept between calls.
+				 */
+				std::vector<datagram> receive_batch(std::size_t max_count, std::size_t max_size, int timeout_ms)
+				{
+					scoped_io_job job(*this, io_direction::read);
+					std::vector<datagram> out;
+					drain(out, max_count, max_size);
+					if (out.empty() && timeout_ms != 0 && wait_readable(timeout_ms))
+						drain(out, max_count, max_size);
+					return out;
+				}
+
+				// For async.receive_batch: call with the read job held, once
+				// the socket is readable
+				void drain_batch(std::vector<datagram> &out, std::size_t max_count, std::size_t max_size)
+				{
+					drain(out, max_count, max_size);
+				}
+
+				std::size_t send_batch(const std::vector<std::pair<const std::string *, udp::endpoint>> &batch)
+				{
+					scoped_io_job job(*this, io_direction::write);
+					std::vector<slice> slices;
+					slices.reserve(batch.size());
+					for (auto &item : batch)
+						slices.push_back({item.first->data(), item.first->size(), &item.second});
+					send_slices(slices);
+					return batch.size();
+				}
+
+				/*
+				 * UDP segmentation offload. send_segmented splits data into
+				 * segment_size datagrams (the last one may be shorter) to ep;
+				 * on Linux with UDP_SEGMENT the kernel splits up to 64 segments
+				 * per send, otherwise (or once the kernel or NIC reports it
+				 * unsupported, or for a call whose segments it rejects) the
+				 * segments go out through send_batch. Returns the number of
+				 * datagrams. set_opt_gro lets the kernel coalesce received
+				 * datagrams of one flow; the batch receives split them again,
+				 * so a batch may then hold more than max_count datagrams.
+				 * Returns false where UDP_GRO is not available.
+				 */
+				std::size_t send_segmented(const std::string &data, std::size_t segment_size, const udp::endpoint &ep)
+				{
+					scoped_io_job job(*this, io_direction::write);
+					if (segment_size == 0)
+						throw std::invalid_argument("Segment size must be positive.");
+					std::size_t count = (data.size() + segment_size - 1) / segment_size;
+					std::size_t offset = 0;
+#ifdef __linux__
+					constexpr std::size_t max_segments = 64, max_payload = 65507;
+					std::size_t per_send = (std::min)(max_segments, max_payload / segment_size);
+					while (gso_supported.load(std::memory_order_relaxed) && per_send > 1 && offset < data.size()) {
+						std::size_t len = (std::min)(per_send * segment_size, data.size() - offset);
+						if (!send_gso(data.data() + offset, len, segment_size, ep))
+							break;
+						offset += len;
+					}
+#endif
+					std::vector<slice> slices;
+					for (; offset < data.size(); offset += segment_size)
+						slices.push_back({data.data() + offset, (std::min)(segment_size, data.size() - offset), &ep});
+					send_slices(slices);
+					return count;
+				}
+
+				bool gso_available() const
+				{
+#ifdef __linux__
+					return gso_supported.load(std::memory_order_relaxed);
+#else
+					return false;
+#endif
+				}
+
+				bool set_opt_gro(bool enable)
+				{
+#ifdef __linux__
+					int value = enable ? 1 : 0;
+					if (::setsockopt(sock.native_handle(), IPPROTO_UDP, UDP_GRO, &value, sizeof(value)) != 0)
+						return false;
+					gro_enabled = enable;
+					return true;
+#else
+					(void)enable;
+					return false;
+#endif
+				}
+
+			private:
+				std::atomic<std::uint64_t> rx_dropped{0};
+				bool rxq_ovfl_enabled = false;
+
+				bool is_v6()
+				{
+					return sock.local_endpoint().address().is_v6();
+				}
+
+				static unsigned int interface_index(const std::string &iface)
+				{
+					if (iface.empty())
+						return 0;
+					if (iface.find_first_not_of("0123456789") == std::string::npos)
+						return static_cast<unsigned int>(std::stoul(iface));
+#ifndef _WIN32
+					unsigned int index = ::if_nametoindex(iface.c_str());
+					if (index != 0)
+						return index;
+#endif
+					throw std::invalid_argument("Unknown network interface: " + iface);
+				}
+
+				void update_membership(const std::string &group, const std::string &iface, bool join)
+				{
+					auto addr = asio::ip::make_address(group);
+					if (!addr.is_multicast())
+						throw std::invalid_argument("Not a multicast address: " + group);
+					if (addr.is_v6()) {
+						if (join)
+							sock.set_option(asio::ip::multicast::join_group(addr.to_v6(), interface_index(iface)));
+						else
+							sock.set_option(asio::ip::multicast::leave_group(addr.to_v6(), interface_index(iface)));
+					}
+					else {
+						auto local = iface.empty() ? asio::ip::address_v4::any() : asio::ip::make_address_v4(iface);
+						if (join)
+							sock.set_option(asio::ip::multicast::join_group(addr.to_v4(), local));
+						else
+							sock.set_option(asio::ip::multicast::leave_group(addr.to_v4(), local));
+					}
+				}
+
+				struct slice {
+					const char *data;
+					std::size_t size;
+					const udp::endpoint *endpoint;
+				};
+
+				void send_slices(const std::vector<slice> &batch)
+				{
+					std::size_t bytes = 0;
+#ifdef __linux__
+					constexpr std::size_t chunk = 1024;
+					std::vector<mmsghdr> msgs;
+					std::vector<iovec> iov;
+					for (std::size_t base = 0; base < batch.size(); base += chunk) {
+						std::size_t n = (std::min)(chunk, batch.size() - base);
+						msgs.assign(n, mmsghdr{});
+						iov.resize(n);
+						for (std::size_t i = 0; i < n; ++i) {
+							auto &item = batch[base + i];
+							iov[i].iov_base = const_cast<char *>(item.data);
+							iov[i].iov_len = item.size;
+							msgs[i].msg_hdr.msg_iov = &iov[i];
+							msgs[i].msg_hdr.msg_iovlen = 1;
+							msgs[i].msg_hdr.msg_name = const_cast<sockaddr *>(item.endpoint->data());
+							msgs[i].msg_hdr.msg_namelen = static_cast<socklen_t>(item.endpoint->size());
+						}
+						std::size_t sent = 0;
+						while (sent < n) {
+							int rc = ::sendmmsg(sock.native_handle(), msgs.data() + sent, static_cast<unsigned int>(n - sent), 0);
+							if (rc < 0) {
+								if (errno == EINTR)
+									continue;
+								if (errno == EAGAIN || errno == EWOULDBLOCK) {
+									wait_writable();
+									continue;
+								}
+								throw asio::system_error(asio::error_code(errno, asio::system_category()));
+							}
+							for (int i = 0; i < rc; ++i)
+								bytes += msgs[sent + i].msg_len;
+							sent += rc;
+						}
+					}
+#else
+					for (auto &item : batch)
+						bytes += sock.send_to(asio::buffer(item.data, item.size), *item.endpoint);
+#endif
+					metrics::builtin().udp_bytes_sent.add(bytes);
+				}
+
+#ifdef __linux__
+				std::vector<char> batch_storage;
+				std::vector<mmsghdr> batch_msgs;
+				std::vector<iovec> batch_iov;
+				std::vector<sockaddr_storage> batch_addrs;
+				std::vector<char> batch_control;
+				// Cleared once the kernel or NIC reports it cannot offload
+				std::atomic<bool> gso_supported{true};
+				bool gro_enabled = false;
+				static constexpr std::size_t gro_slot_size = 65536, gro_max_slots = 16;
+
+				// One sendmsg with a UDP_SEGMENT control message; false when
+				// this send could not be offloaded and the caller should fall
+				// back
+				bool send_gso(const char *data, std::size_t len, std::size_t segment_size, const udp::endpoint &ep)
+				{
+					alignas(cmsghdr) char control[CMSG_SPACE(sizeof(std::uint16_t))] = {};
+					iovec iov{const_cast<char *>(data), len};
+					msghdr msg{};
+					msg.msg_name = const_cast<sockaddr *>(ep.data());
+					msg.msg_namelen = static_cast<socklen_t>(ep.size());
+					msg.msg_iov = &iov;
+					msg.msg_iovlen = 1;
+					msg.msg_control = control;
+					msg.msg_controllen = sizeof(control);
+					cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+					cm->cmsg_level = IPPROTO_UDP;
+					cm->cmsg_type = UDP_SEGMENT;
+					cm->cmsg_len = CMSG_LEN(sizeof(std::uint16_t));
+					auto gso_size = static_cast<std::uint16_t>(segment_size);
+					std::memcpy(CMSG_DATA(cm), &gso_size, sizeof(gso_size));
+					for (;;) {
+						ssize_t rc = ::sendmsg(sock.native_handle(), &msg, 0);
+						if (rc >= 0) {
+							metrics::builtin().udp_bytes_sent.add(static_cast<std::size_t>(rc));
+							return true;
+						}
+						if (errno == EINTR)
+							continue;
+						if (errno == EAGAIN || errno == EWOULDBLOCK) {
+							wait_writable();
+							continue;
+						}
+						if (errno == EIO || errno == ENOPROTOOPT || errno == EOPNOTSUPP) {
+							gso_supported.store(false, std::memory_order_relaxed);
+							return false;
+						}
+						// Refused for this send only (e.g. a segment size the
+						// path MTU cannot carry): later sends may still offload
+						if (errno == EINVAL)
+							return false;
+						throw asio::system_error(asio::error_code(errno, asio::system_category()));
+					}
+				}
+#else
+				std::vector<char> batch_storage;
+#endif
+
+				bool wait_readable(int timeout_ms)
+				{
+#ifdef _WIN32
+					WSAPOLLFD pfd{};
+					pfd.fd = sock.native_handle();
+					pfd.events = POLLRDNORM;
+					int rc = ::WSAPoll(&pfd, 1, timeout_ms);
+#else
+					pollfd pfd{};
+					pfd.fd = sock.native_handle();
+					pfd.events = POLLIN;
+					int rc;
+					do
+						rc = ::poll(&pfd, 1, timeout_ms);
+					while (rc < 0 && errno == EINTR);
+#endif
+					return rc > 0;
+				}
+
+				void wait_writable()
+				{
+#ifndef _WIN32
+					pollfd pfd{};
+					pfd.fd = sock.native_handle();
+					pfd.events = POLLOUT;
+					while (::poll(&pfd, 1, -1) < 0 && errno == EINTR);
+#endif
+				}
+
+				void drain(std::vector<datagram> &out, std::size_t max_count, std::size_t max_size)
+				{
+					if (max_count == 0)
+						return;
+					std::size_t bytes = 0;
+#ifdef __linux__
+					// A coalesced GRO read can carry up to 64 KiB, so every slot
+					// must hold that much; fewer slots keep the buffer bounded
+					std::size_t slots = gro_enabled ? (std::min)(max_count, gro_max_slots) : max_count;
+					std::size_t slot_size = gro_enabled ? gro_slot_size : max_size;
+					constexpr std::size_t control_size = CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(std::uint32_t));
+					bool want_control = gro_enabled || rxq_ovfl_enabled;
+					if (batch_storage.size() < slots * slot_size)
+						batch_storage.resize(slots * slot_size);
+					batch_msgs.assign(slots, mmsghdr{});
+					batch_iov.resize(slots);
+					batch_addrs.resize(slots);
+					if (want_control)
+						batch_control.assign(slots * control_size, 0);
+					for (std::size_t i = 0; i < slots; ++i) {
+						batch_iov[i].iov_base = batch_storage.data() + i * slot_size;
+						batch_iov[i].iov_len = slot_size;
+						batch_msgs[i].msg_hdr.msg_iov = &batch_iov[i];
+						batch_msgs[i].msg_hdr.msg_iovlen = 1;
+						batch_msgs[i].msg_hdr.msg_name = &batch_addrs[i];
+						batch_msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+						if (want_control) {
+							batch_msgs[i].msg_hdr.msg_control = batch_control.data() + i * control_size;
+							batch_msgs[i].msg_hdr.msg_controllen = control_size;
+						}
+					}
+					int rc;
+					do
+						rc = ::recvmmsg(sock.native_handle(), batch_msgs.data(), static_cast<unsigned int>(slots), MSG_DONTWAIT, nullptr);
+					while (rc < 0 && errno == EINTR);
+					if (rc < 0) {
+						if (errno == EAGAIN || errno == EWOULDBLOCK)
+							return;
+						throw asio::system_error(asio::error_code(errno, asio::system_category()));
+					}
+					out.reserve(out.size() + rc);
+					for (int i = 0; i < rc; ++i) {
+						const char *data = batch_storage.data() + i * slot_size;
+						std::size_t len = batch_msgs[i].msg_len;
+						std::size_t segment = len;
+						if (want_control) {
+							msghdr &hdr = batch_msgs[i].msg_hdr;
+							for (cmsghdr *cm = CMSG_FIRSTHDR(&hdr); cm != nullptr; cm = CMSG_NXTHDR(&hdr, cm)) {
+								if (cm->cmsg_level == IPPROTO_UDP && cm->cmsg_type == UDP_GRO && cm->cmsg_len >= CMSG_LEN(sizeof(int))) {
+									int gso_size = 0;
+									std::memcpy(&gso_size, CMSG_DATA(cm), sizeof(gso_size));
+									if (gso_size > 0)
+										segment = static_cast<std::size_t>(gso_size);
+								}
+#ifdef SO_RXQ_OVFL
+								else if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_RXQ_OVFL && cm->cmsg_len >= CMSG_LEN(sizeof(std::uint32_t))) {
+									std::uint32_t drops = 0;
+									std::memcpy(&drops, CMSG_DATA(cm), sizeof(drops));
+									rx_dropped.store(drops, std::memory_order_relaxed);
+								}
+#endif
+							}
+						}
+						std::size_t offset = 0;
+						do {
+							datagram d;
+							std::size_t n = (std::min)(segment, len - offset);
+							d.data.assign(data + offset, (std::min)(n, max_size));
+							std::memcpy(d.endpoint.data(), &batch_addrs[i], batch_msgs[i].msg_hdr.msg_namelen);
+							d.endpoint.resize(batch_msgs[i].msg_hdr.msg_namelen);
+							bytes += d.data.size();
+							out.push_back(std::move(d));
+							offset += n;
+						} while (offset < len);
+					}
+#else
+					if (batch_storage.size() < max_size)
+						batch_storage.resize(max_size);
+					bool blocking = !sock.non_blocking();
+					sock.non_blocking(true);
+					asio::error_code ec;
+					std::size_t count = 0;
+					for (; count < max_count; ++count) {
+						datagram d;
+						std::size_t n = sock.receive_from(asio::buffer(batch_storage.data(), max_size), d.endpoint, 0, ec);
+						if (ec)
+							break;
+						d.data.assign(batch_storage.data(), n);
+						bytes += n;
+						out.push_back(std::move(d));
+					}
+					if (blocking)
+						sock.non_blocking(false);
+					if (ec && ec != asio::error::would_block && count == 0)
+						throw asio::system_error(ec);
+#endif
+					metrics::builtin().udp_bytes_received.add(bytes);
+				}
+			};
+
+			/*
+			 * Keeps K async_receive_from posted on one socket, each with its
+			 * own pooled buffer, and queues the datagrams so that several
+			 * thread_workers can drain a hot port in parallel. The receiver
+			 * holds the socket's receive slot until it is stopped; stop()
+			 * cancels only its own receives (per-operation cancellation on a
+			 * strand), so pending sends are left alone. When the queue is
+			 * full new datagrams are dropped and counted in overflow().
+			 */
+			class multi_receiver final : public std::enable_shared_from_this<multi_receiver> {
+				struct slot {
+					std::vector<char> buffer;
+					udp::endpoint endpoint;
+					asio::cancellation_signal cancel;
+				};
+
+				std::shared_ptr<socket> sock;
+				asio::strand<asio::io_context::executor_type> strand;
+				std::vector<std::unique_ptr<slot>> slots;
+				std::size_t capacity;
+				// Touched only on the strand
+				std::size_t pending = 0;
+				bool running = false;
+				std::atomic<bool> finished{false};
+
+				mutable std::mutex mutex;
+				std::deque<datagram> queue;
+				std::uint64_t overflowed = 0;
+				asio::error_code last_error;
+
+				void post(std::size_t i)
+				{
+					slot &s = *slots[i];
+					sock->get_raw().async_receive_from(asio::buffer(s.buffer), s.endpoint,
+					    asio::bind_cancellation_slot(s.cancel.slot(), asio::bind_executor(strand,
+					    [self = shared_from_this(), i](const asio::error_code &ec, std::size_t n) {
+						    self->complete(i, ec, n);
+					    })));
+				}
+
+				void complete(std::size_t i, const asio::error_code &ec, std::size_t n)
+				{
+					if (!ec) {
+						metrics::builtin().udp_bytes_received.add(n);
+						slot &s = *slots[i];
+						std::lock_guard<std::mutex> lock(mutex);
+						if (queue.size() < capacity)
+							queue.push_back(datagram{std::string(s.buffer.data(), n), s.endpoint});
+						else
+							++overflowed;
+					}
+					else if (ec != asio::error::operation_aborted) {
+						std::lock_guard<std::mutex> lock(mutex);
+						last_error = ec;
+					}
+					// ICMP errors on connected sockets are transient; a closed
+					// socket or a stop ends this slot
+					if (running && ec != asio::error::operation_aborted && ec != asio::error::bad_descriptor) {
+						try {
+							post(i);
+							return;
+						}
+						catch (const std::exception &) {
+						}
+					}
+					if (--pending == 0) {
+						running = false;
+						sock->end_async_receive();
+						finished.store(true, std::memory_order_release);
+					}
+				}
+
+			public:
+				multi_receiver(std::shared_ptr<socket> s, std::size_t count, std::size_t max_size, std::size_t queue_capacity)
+					: sock(std::move(s)), strand(asio::make_strand(get_io_context())), capacity(queue_capacity)
+				{
+					slots.reserve(count);
+					for (std::size_t i = 0; i < count; ++i) {
+						slots.emplace_back(new slot);
+						slots.back()->buffer.resize(max_size);
+					}
+				}
+
+				multi_receiver(const multi_receiver &) = delete;
+
+				// Must be called once, right after construction
+				void start()
+				{
+					sock->begin_async_receive();
+					asio::post(strand, [self = shared_from_this()] {
+						self->running = true;
+						for (std::size_t i = 0; i < self->slots.size(); ++i) {
+							try {
+								self->post(i);
+								++self->pending;
+							}
+							catch (const std::exception &) {
+							}
+						}
+						if (self->pending == 0) {
+							self->running = false;
+							self->sock->end_async_receive();
+							self->finished.store(true, std::memory_order_release);
+						}
+					});
+				}
+
+				// Asynchronous; finished() turns true once every receive is done
+				void stop()
+				{
+					asio::post(strand, [self = shared_from_this()] {
+						self->running = false;
+						for (auto &s : self->slots)
+							s->cancel.emit(asio::cancellation_type::terminal);
+					});
+				}
+
+				bool finished_receiving() const
+				{
+					return finished.load(std::memory_order_acquire);
+				}
+
+				std::vector<datagram> take(std::size_t max_count)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					std::size_t n = (std::min)(max_count, queue.size());
+					std::vector<datagram> out;
+					out.reserve(n);
+					for (std::size_t i = 0; i < n; ++i) {
+						out.push_back(std::move(queue.front()));
+						queue.pop_front();
+					}
+					return out;
+				}
+
+				std::size_t size() const
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					return queue.size();
+				}
+
+				std::uint64_t overflow() const
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					return overflowed;
+				}
+
+				std::string error() const
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					return last_error ? last_error.message() : std::string();
+				}
+			};
+		}
+
+		namespace http {
+			/*
+			 * IMF-fixdate of the current second for the HTTP Date header.
+			 * A timer on the shared io_context refreshes the string every
+			 * second while it is in use (and stops after a few idle seconds),
+			 * so readers normally only copy it; a reader that still sees a
+			 * stale second (io_context not polled) refreshes it inline.
+			 */
+			class date_cache final {
+				std::mutex mtx;
+				std::time_t second = -1;
+				std::time_t last_access = 0;
+				std::string value;
+				asio::steady_timer timer;
+				bool armed = false;
+
+				void refresh(std::time_t now)
+				{
+					static const char *wday[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+					static const char *mon[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+					std::tm tm{};
+#ifdef _WIN32
+					gmtime_s(&tm, &now);
+#else
+					gmtime_r(&now, &tm);
+#endif
+					char buff[32];
+					std::snprintf(buff, sizeof(buff), "%s, %02d %s %04d %02d:%02d:%02d GMT",
+					              wday[tm.tm_wday], tm.tm_mday, mon[tm.tm_mon], tm.tm_year + 1900,
+					              tm.tm_hour, tm.tm_min, tm.tm_sec);
+					value = buff;
+					second = now;
+				}
+
+				// Call with mtx held
+				void arm()
+				{
+					timer.expires_after(std::chrono::seconds(1));
+					timer.async_wait([this](const asio::error_code &ec) {
+						if (ec)
+							return;
+						std::lock_guard<std::mutex> lock(mtx);
+						std::time_t now = std::time(nullptr);
+						refresh(now);
+						if (now - last_access > 2)
+							armed = false;
+						else
+							arm();
+					});
+				}
+
+			public:
+				date_cache() : timer(get_io_context()) {}
+
+				std::string get()
+				{
+					std::time_t now = std::time(nullptr);
+					std::lock_guard<std::mutex> lock(mtx);
+					last_access = now;
+					if (now != second)
+						refresh(now);
+					if (!armed) {
+						armed = true;
+						arm();
+					}
+					return value;
+				}
+			};
+
+			static date_cache &get_date_cache()
+			{
+				static date_cache instance;
+				return instance;
+			}
+
+			/*
+			 * Compressed radix tree of URL patterns.
+			 * A pattern is static text mixed with ":name" segments (one path
+			 * segment) and a final "*name" or "*" segment (rest of the path).
+			 * Routes also match as path prefixes: the path must continue with
+			 * '/' unless the matched part already ends with '/'. Exact matches
+			 * win over prefixes, longer prefixes over shorter ones, and static
+			 * text over parameters over wildcards.
+			 */
+			class router final {
+			public:
+				using params_type = std::vector<std::pair<std::string, std::string>>;
+
+				struct match_result {
+					std::string route;
+					params_type params;
+					bool exact = false;
+					// Methods bound at the matched pattern (any-method lookups only)
+					std::vector<std::string> methods;
+				};
+
+			private:
+				struct node {
+					std::string label;
+					std::vector<std::unique_ptr<node>> children;
+					std::unique_ptr<node> param_child;
+					std::unique_ptr<node> wildcard_child;
+					// Parameter name of param/wildcard nodes
+					std::string name;
+					// Method ("*" for any) -> route id
+					std::map<std::string, std::string> routes;
+				};
+
+				struct search {
+					const std::string &method;
+					const std::string &path;
+					params_type params;
+					match_result prefix;
+					std::size_t prefix_len = 0;
+
+					search(const std::string &m, const std::string &p) : method(m), path(p) {}
+				};
+
+				node root;
+				std::size_t route_count = 0;
+
+				// An empty method matches a route of any method
+				static const std::string *find_route(const node *n, const std::string &method)
+				{
+					if (method.empty())
+						return n->routes.empty() ? nullptr : &n->routes.begin()->second;
+					auto it = n->routes.find(method);
+					if (it == n->routes.end())
+						it = n->routes.find("*");
+					return it == n->routes.end() ? nullptr : &it->second;
+				}
+
+				static node *insert_static(node *n, const std::string &text)
+				{
+					std::size_t pos = 0;
+					while (pos < text.size()) {
+						node *next = nullptr;
+						for (auto &child : n->children) {
+							if (child->label[0] != text[pos])
+								continue;
+							std::size_t len = 1;
+							while (len < child->label.size() && pos + len < text.size() && child->label[len] == text[pos + len])
+								++len;
+							if (len < child->label.size()) {
+								// Split the edge at the end of the common prefix
+								auto tail = std::make_unique<node>();
+								tail->label = child->label.substr(len);
+								tail->children.swap(child->children);
+								tail->param_child = std::move(child->param_child);
+								tail->wildcard_child = std::move(child->wildcard_child);
+								tail->routes.swap(child->routes);
+								child->label.resize(len);
+								child->children.push_back(std::move(tail));
+							}
+							pos += len;
+							next = child.get();
+							break;
+						}
+						if (next == nullptr) {
+							auto leaf = std::make_unique<node>();
+							leaf->label = text.substr(pos);
+							next = leaf.get();
+							n->children.push_back(std::move(leaf));
+							pos = text.size();
+						}
+						n = next;
+					}
+					return n;
+				}
+
+				static void record(const search &s, const node *n, const std::string &route, match_result &result)
+				{
+					result.route = route;
+					result.params = s.params;
+					if (s.method.empty()) {
+						result.methods.clear();
+						for (auto &it : n->routes)
+							result.methods.push_back(it.first);
+					}
+				}
+
+				static bool lookup(const node *n, std::size_t pos, search &s, match_result &result)
+				{
+					const std::string &path = s.path;
+					if (pos == path.size()) {
+						if (const std::string *route = find_route(n, s.method)) {
+							record(s, n, *route, result);
+							result.exact = true;
+							return true;
+						}
+					}
+					else if (pos > 0 && (path[pos - 1] == '/' || path[pos] == '/') && pos > s.prefix_len) {
+						if (const std::string *route = find_route(n, s.method)) {
+							record(s, n, *route, s.prefix);
+							s.prefix_len = pos;
+						}
+					}
+					if (pos < path.size()) {
+						for (auto &child : n->children) {
+							if (child->label[0] != path[pos])
+								continue;
+							if (path.compare(pos, child->label.size(), child->label) == 0 && lookup(child.get(), pos + child->label.size(), s, result))
+								return true;
+							break;
+						}
+						if (n->param_child) {
+							std::size_t end = path.find('/', pos);
+							if (end == std::string::npos)
+								end = path.size();
+							if (end > pos) {
+								s.params.emplace_back(n->param_child->name, path.substr(pos, end - pos));
+								bool found = lookup(n->param_child.get(), end, s, result);
+								s.params.pop_back();
+								if (found)
+									return true;
+							}
+						}
+					}
+					if (n->wildcard_child) {
+						if (const std::string *route = find_route(n->wildcard_child.get(), s.method)) {
+							record(s, n->wildcard_child.get(), *route, result);
+							if (!n->wildcard_child->name.empty())
+								result.params.emplace_back(n->wildcard_child->name, path.substr(pos));
+							result.exact = true;
+							return true;
+						}
+					}
+					return false;
+				}
+
+			public:
+				// Register route under pattern for method ("*" for any method),
+				// replacing a previous registration of the same pair.
+				void add(const std::string &method, const std::string &pattern, const std::string &route)
+				{
+					if (pattern.empty() || pattern[0] != '/')
+						throw std::invalid_argument("Route pattern must start with '/': " + pattern);
+					node *n = &root;
+					std::size_t pos = 0;
+					while (pos < pattern.size()) {
+						// ':' and '*' are only special at the start of a segment
+						std::size_t special = pattern.find_first_of(":*", pos);
+						while (special != std::string::npos && pattern[special - 1] != '/')
+							special = pattern.find_first_of(":*", special + 1);
+						if (special == std::string::npos) {
+							n = insert_static(n, pattern.substr(pos));
+							break;
+						}
+						if (special > pos)
+							n = insert_static(n, pattern.substr(pos, special - pos));
+						std::size_t end = pattern.find('/', special);
+						if (end == std::string::npos)
+							end = pattern.size();
+						std::string name = pattern.substr(special + 1, end - special - 1);
+						std::unique_ptr<node> &slot = pattern[special] == ':' ? n->param_child : n->wildcard_child;
+						if (pattern[special] == ':' && name.empty())
+							throw std::invalid_argument("Empty parameter name in route: " + pattern);
+						if (pattern[special] == '*' && end != pattern.size())
+							throw std::invalid_argument("Wildcard must be the last segment of route: " + pattern);
+						if (!slot) {
+							slot = std::make_unique<node>();
+							slot->name = name;
+						}
+						else if (slot->name != name)
+							throw std::invalid_argument("Conflicting parameter name \"" + name + "\" in route: " + pattern);
+						n = slot.get();
+						pos = end;
+					}
+					if (n->routes.count(method) == 0)
+						++route_count;
+					n->routes[method] = route;
+				}
+
+				// Find the route for method and path: the exact match with the
+				// highest priority, otherwise the longest prefix match.
+				bool match(const std::string &method, const std::string &path, match_result &result) const
+				{
+					search s(method, path);
+					if (lookup(&root, 0, s, result))
+						return true;
+					if (s.prefix_len == 0)
+						return false;
+					result = std::move(s.prefix);
+					return true;
+				}
+
+				// Methods bound at the pattern that would serve path if the
+				// method matched, or nothing when no pattern matches
+				std::vector<std::string> allowed(const std::string &path) const
+				{
+					match_result result;
+					if (!match(std::string(), path, result))
+						return {};
+					return result.methods;
+				}
+
+				std::size_t size() const
+				{
+					return route_count;
+				}
+			};
+
+			/*
+			 * Access log with a background writer thread.
+			 * Producers format an entry and push it into a bounded lock-free
+			 * ring (Vyukov MPMC queue, used here with a single consumer);
+			 * push fails instead of blocking when the ring is full, leaving
+			 * the choice between dropping and retrying to the caller. The
+			 * writer wakes every flush_ms, writes everything queued with one
+			 * fwrite and flushes the file.
+			 */
+			class access_log final {
+			public:
+				enum class format_type {
+					combined, json
+				};
+
+				enum class push_result {
+					queued, full, closed
+				};
+
+				struct entry {
+					std::string remote;
+					std::string method;
+					std::string target;
+					std::string version;
+					std::string status;
+					std::size_t bytes = 0;
+					double latency_ms = 0;
+					std::string referer;
+					std::string user_agent;
+				};
+
+			private:
+				struct cell {
+					std::atomic<std::size_t> seq{0};
+					std::string data;
+				};
+
+				std::unique_ptr<cell[]> ring;
+				std::size_t mask = 0;
+				std::atomic<std::size_t> enqueue_pos{0};
+				std::size_t dequeue_pos = 0;
+				std::atomic<std::size_t> pushed{0};
+				std::atomic<std::size_t> written{0};
+				std::atomic<std::size_t> dropped{0};
+
+				std::FILE *file = nullptr;
+				std::chrono::milliseconds flush_interval;
+				std::thread writer;
+				std::mutex wake_mutex;
+				std::condition_variable wake;
+				// Producers check accepting, close() waits for in-flight ones
+				// before telling the writer to stop (running) and drain
+				std::atomic<bool> accepting{true};
+				std::atomic<std::size_t> producers{0};
+				std::atomic<bool> running{true};
+				format_type fmt = format_type::combined;
+				bool block_on_full = false;
+
+				bool pop(std::string &out)
+				{
+					cell &c = ring[dequeue_pos & mask];
+					if (c.seq.load(std::memory_order_acquire) != dequeue_pos + 1)
+						return false;
+					out.append(c.data);
+					out.push_back('\n');
+					c.data.clear();
+					c.seq.store(dequeue_pos + mask + 1, std::memory_order_release);
+					++dequeue_pos;
+					return true;
+				}
+
+				void drain()
+				{
+					std::string batch;
+					std::size_t count = 0;
+					while (pop(batch))
+						++count;
+					if (count == 0)
+						return;
+					std::fwrite(batch.data(), 1, batch.size(), file);
+					std::fflush(file);
+					written.fetch_add(count, std::memory_order_release);
+				}
+
+				void run()
+				{
+					while (running.load(std::memory_order_acquire)) {
+						{
+							std::unique_lock<std::mutex> lock(wake_mutex);
+							wake.wait_for(lock, flush_interval);
+						}
+						drain();
+					}
+					drain();
+				}
+
+				static void append_json_string(std::string &out, const std::string &str)
+				{
+					out.push_back('"');
+					for (unsigned char ch : str) {
+						switch (ch) {
+						case '"':
+							out.append("\\\"");
+							break;
+						case '\\':
+							out.append("\\\\");
+							break;
+						case '\n':
+							out.append("\\n");
+							break;
+						case '\r':
+							out.append("\\r");
+							break;
+						case '\t':
+							out.append("\\t");
+							break;
+						default:
+							if (ch < 0x20) {
+								char buff[8];
+								std::snprintf(buff, sizeof(buff), "\\u%04x", ch);
+								out.append(buff);
+							}
+							else
+								out.push_back(static_cast<char>(ch));
+						}
+					}
+					out.push_back('"');
+				}
+
+				static std::string or_dash(const std::string &str)
+				{
+					return str.empty() ? "-" : str;
+				}
+
+			public:
+				access_log(const std::string &path, std::size_t capacity, std::size_t flush_ms) : flush_interval(flush_ms)
+				{
+					std::size_t size = 2;
+					while (size < capacity)
+						size <<= 1;
+					ring.reset(new cell[size]);
+					mask = size - 1;
+					for (std::size_t i = 0; i < size; ++i)
+						ring[i].seq.store(i, std::memory_order_relaxed);
+					file = std::fopen(path.c_str(), "ab");
+					if (file == nullptr)
+						throw std::runtime_error("Cannot open access log: " + path);
+					writer = std::thread([this]() {
+						run();
+					});
+				}
+
+				access_log(const access_log &) = delete;
+
+				~access_log()
+				{
+					close();
+				}
+
+				void set_format(format_type f)
+				{
+					fmt = f;
+				}
+
+				// Whether writers should wait for space instead of dropping
+				void set_blocking(bool value)
+				{
+					block_on_full = value;
+				}
+
+				bool blocking() const
+				{
+					return block_on_full;
+				}
+
+				// Queue one line (without trailing newline). line is left
+				// untouched unless it was queued.
+				push_result push(std::string &line)
+				{
+					producers.fetch_add(1);
+					struct producer_guard {
+						std::atomic<std::size_t> &count;
+						~producer_guard()
+						{
+							count.fetch_sub(1);
+						}
+					} guard{producers};
+					if (!accepting.load())
+						return push_result::closed;
+					std::size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+					cell *c = nullptr;
+					while (true) {
+						c = &ring[pos & mask];
+						std::size_t seq = c->seq.load(std::memory_order_acquire);
+						if (seq == pos) {
+							if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+								break;
+						}
+						else if (seq < pos)
+							return push_result::full;
+						else
+							pos = enqueue_pos.load(std::memory_order_relaxed);
+					}
+					c->data = std::move(line);
+					c->seq.store(pos + 1, std::memory_order_release);
+					pushed.fetch_add(1, std::memory_order_relaxed);
+					return push_result::queued;
+				}
+
+				void count_drop()
+				{
+					dropped.fetch_add(1, std::memory_order_relaxed);
+				}
+
+				std::string format(const entry &e) const
+				{
+					std::time_t now = std::time(nullptr);
+					std::tm tm{};
+#ifdef _WIN32
+					gmtime_s(&tm, &now);
+#else
+					gmtime_r(&now, &tm);
+#endif
+					char time_buff[64];
+					std::string status = e.status;
+					// Accept a bare code, a reason phrase or a full status line
+					if (status.compare(0, 5, "HTTP/") == 0 && status.find(' ') != std::string::npos)
+						status = status.substr(status.find(' ') + 1);
+					status = status.substr(0, 3);
+					std::string out;
+					if (fmt == format_type::json) {
+						std::strftime(time_buff, sizeof(time_buff), "%Y-%m-%dT%H:%M:%SZ", &tm);
+						out.append("{\"time\":\"").append(time_buff).append("\",\"remote\":");
+						append_json_string(out, e.remote);
+						out.append(",\"method\":");
+						append_json_string(out, e.method);
+						out.append(",\"target\":");
+						append_json_string(out, e.target);
+						out.append(",\"version\":");
+						append_json_string(out, e.version);
+						out.append(",\"status\":").append(status.empty() ? "0" : status);
+						out.append(",\"bytes\":").append(std::to_string(e.bytes));
+						std::snprintf(time_buff, sizeof(time_buff), "%.3f", e.latency_ms);
+						out.append(",\"latency_ms\":").append(time_buff);
+						out.append(",\"referer\":");
+						append_json_string(out, e.referer);
+						out.append(",\"user_agent\":");
+						append_json_string(out, e.user_agent);
+						out.push_back('}');
+					}
+					else {
+						// NCSA combined log format followed by the latency in ms
+						std::strftime(time_buff, sizeof(time_buff), "%d/%b/%Y:%H:%M:%S +0000", &tm);
+						out.append(or_dash(e.remote)).append(" - - [").append(time_buff).append("] \"");
+						out.append(e.method).append(" ").append(e.target).append(" ").append(e.version).append("\" ");
+						out.append(or_dash(status)).append(" ").append(std::to_string(e.bytes)).append(" \"");
+						out.append(or_dash(e.referer)).append("\" \"").append(or_dash(e.user_agent)).append("\" ");
+						std::snprintf(time_buff, sizeof(time_buff), "%.3f", e.latency_ms);
+						out.append(time_buff);
+					}
+					return out;
+				}
+
+				// Whether the first target queued lines have been written
+				bool flushed(std::size_t target) const
+				{
+					return written.load(std::memory_order_acquire) >= target;
+				}
+
+				std::size_t queued() const
+				{
+					return pushed.load(std::memory_order_relaxed);
+				}
+
+				std::size_t dropped_count() const
+				{
+					return dropped.load(std::memory_order_relaxed);
+				}
+
+				void notify()
+				{
+					wake.notify_one();
+				}
+
+				bool closed() const
+				{
+					return !accepting.load(std::memory_order_acquire);
+				}
+
+				void close()
+				{
+					if (!accepting.exchange(false))
+						return;
+					// A producer past the accepting check still publishes its
+					// cell; the writer's final drain must see it
+					while (producers.load() > 0)
+						std::this_thread::yield();
+					running.store(false, std::memory_order_release);
+					wake.notify_one();
+					if (writer.joinable())
+						writer.join();
+					std::fclose(file);
+					file = nullptr;
+				}
+			};
+
+			/*
+			 * Token-bucket rate limiter keyed by client (an address, a header
+			 * value, ...). Every key refills at rate tokens per second up to
+			 * burst tokens. Buckets are spread over shards by key hash, each
+			 * with its own mutex, so concurrent lookups rarely contend. Each
+			 * shard keeps its buckets in least-recently-used order. A bucket
+			 * left idle until it is full again behaves exactly like a missing
+			 * one, so at most once per refill period each shard drops those
+			 * from the cold end; a shard that still holds max_keys / shards
+			 * buckets evicts the least recently used one to make room, which
+			 * at worst hands that client a fresh, full bucket.
+			 */
+			class rate_limiter final {
+				using clock = std::chrono::steady_clock;
+
+				// Keys point into the map, whose nodes never move
+				using lru_list = std::list<const std::string *>;
+
+				struct bucket {
+					double tokens;
+					clock::time_point last;
+					lru_list::iterator pos;
+				};
+
+				struct shard {
+					std::mutex mtx;
+					std::unordered_map<std::string, bucket> buckets;
+					// Most recently used first
+					lru_list lru;
+					clock::time_point next_sweep;
+				};
+
+				static constexpr std::size_t shard_count = 16;
+
+				std::unique_ptr<shard[]> shards;
+				double rate;
+				double burst;
+				clock::duration refill_time;
+				std::size_t shard_capacity;
+
+				// Call with s.mtx held
+				static void evict_oldest(shard &s)
+				{
+					const std::string *key = s.lru.back();
+					s.lru.pop_back();
+					s.buckets.erase(*key);
+				}
+
+				// Call with s.mtx held; idle buckets sit at the cold end
+				void sweep(shard &s, clock::time_point now)
+				{
+					while (!s.lru.empty() && now - s.buckets.find(*s.lru.back())->second.last >= refill_time)
+						evict_oldest(s);
+					s.next_sweep = now + refill_time;
+				}
+
+			public:
+				rate_limiter(double rate_per_sec, double burst_tokens, std::size_t max_keys)
+					: shards(new shard[shard_count]), rate(rate_per_sec), burst(burst_tokens)
+				{
+					if (!(rate > 0))
+						throw std::invalid_argument("Rate limit must be greater than zero.");
+					if (!(burst >= 1))
+						throw std::invalid_argument("Rate limit burst must be at least one.");
+					refill_time = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(burst / rate));
+					if (refill_time < std::chrono::seconds(1))
+						refill_time = std::chrono::seconds(1);
+					shard_capacity = (std::max)(max_keys / shard_count, std::size_t(1));
+				}
+
+				/*
+				 * Take cost tokens from the bucket of key. Returns 0 if they
+				 * were available, otherwise the time in milliseconds until
+				 * they will be (nothing is taken then).
+				 */
+				double acquire(const std::string &key, double cost = 1)
+				{
+					auto now = clock::now();
+					shard &s = shards[std::hash<std::string> {}(key) % shard_count];
+					std::lock_guard<std::mutex> lock(s.mtx);
+					if (now >= s.next_sweep)
+						sweep(s, now);
+					auto it = s.buckets.find(key);
+					if (it == s.buckets.end()) {
+						if (s.buckets.size() >= shard_capacity)
+							evict_oldest(s);
+						it = s.buckets.emplace(key, bucket{burst, now, s.lru.end()}).first;
+						it->second.pos = s.lru.insert(s.lru.begin(), &it->first);
+					}
+					else if (it->second.pos != s.lru.begin())
+						s.lru.splice(s.lru.begin(), s.lru, it->second.pos);
+					bucket &b = it->second;
+					b.tokens = (std::min)(burst, b.tokens + std::chrono::duration<double>(now - b.last).count() * rate);
+					b.last = now;
+					if (b.tokens >= cost) {
+						b.tokens -= cost;
+						return 0;
+					}
+					return (cost - b.tokens) * 1000 / rate;
+				}
+
+				// Largest cost a bucket can ever satisfy
+				double get_burst() const
+				{
+					return burst;
+				}
+
+				std::size_t size()
+				{
+					std::size_t n = 0;
+					for (std::size_t i = 0; i < shard_count; ++i) {
+						std::lock_guard<std::mutex> lock(shards[i].mtx);
+						n += shards[i].buckets.size();
+					}
+					return n;
+				}
+
+				void clear()
+				{
+					for (std::size_t i = 0; i < shard_count; ++i) {
+						std::lock_guard<std::mutex> lock(shards[i].mtx);
+						shards[i].buckets.clear();
+						shards[i].lru.clear();
+					}
+				}
 			};
 		}
 	}
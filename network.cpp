@@ -24,13 +24,17 @@
 #include <covscript/cni.hpp>
 #include <network.hpp>
 #include <chrono>
+#include <filesystem>
 #include <optional>
 #include <cstdio>
 #include <thread>
 #include <memory>
 #include <mutex>
 #include <regex>
+#include <cmath>
+#include <climits>
 #include <array>
+#include <deque>
 
 inline void cs_runtime_yield()
 {
@@ -172,6 +176,20 @@ namespace network_cs_ext {
 		return asio::ip::host_name();
 	}
 
+	// TTLs in milliseconds; a zero TTL or capacity disables that part
+	void set_resolve_cache(number positive_ttl_ms, number negative_ttl_ms, number max_entries)
+	{
+		if (positive_ttl_ms < 0 || negative_ttl_ms < 0 || max_entries < 0)
+			throw lang_error("Resolve cache TTLs and capacity must not be negative.");
+		cs_impl::network::dns::cache().configure(std::chrono::milliseconds(static_cast<long long>(positive_ttl_ms)),
+		        std::chrono::milliseconds(static_cast<long long>(negative_ttl_ms)), static_cast<std::size_t>(max_entries));
+	}
+
+	void clear_resolve_cache()
+	{
+		cs_impl::network::dns::cache().clear();
+	}
+
 	string get_last_global_ssl_trust_report()
 	{
 		return cs_impl::network::detail::get_last_tls_trust_report();
@@ -194,6 +212,48 @@ namespace network_cs_ext {
 			}
 		}
 
+		var acceptor_with_backlog(const endpoint_t &ep, number backlog)
+		{
+			if (!(backlog >= 1 && backlog <= INT_MAX))
+				throw lang_error("Backlog must be in range [1, " + std::to_string(INT_MAX) + "].");
+			try {
+				return var::make<acceptor_t>(
+				           std::make_shared<asio::ip::tcp::acceptor>(cs_impl::network::tcp::acceptor(ep, static_cast<int>(backlog))));
+			}
+			catch (const std::exception &e) {
+				throw lang_error(e.what());
+			}
+		}
+
+		// Host-wide counters; refreshes the matching metrics gauges
+		var listen_stats()
+		{
+			std::uint64_t overflows = 0, drops = 0;
+			if (!cs_impl::network::tcp::read_listen_counters(overflows, drops))
+				throw lang_error("Listen queue counters are not available on this platform.");
+			auto &stats = cs_impl::network::metrics::builtin();
+			stats.tcp_listen_overflows.set(static_cast<std::int64_t>(overflows));
+			stats.tcp_listen_drops.set(static_cast<std::int64_t>(drops));
+			hash_map m;
+			m[var::make<string>("overflows")] = var::make<number>(static_cast<number>(overflows));
+			m[var::make<string>("drops")] = var::make<number>(static_cast<number>(drops));
+			return var::make<hash_map>(std::move(m));
+		}
+
+		var acceptor_from_handle(number handle)
+		{
+			if (handle < 0)
+				throw lang_error("Invalid listening socket handle.");
+			try {
+				return var::make<acceptor_t>(
+				           std::make_shared<asio::ip::tcp::acceptor>(cs_impl::network::tcp::acceptor_from_handle(
+				                   static_cast<asio::ip::tcp::acceptor::native_handle_type>(handle))));
+			}
+			catch (const std::exception &e) {
+				throw lang_error(e.what());
+			}
+		}
+
 		var endpoint(const string &host, number port)
 		{
 			if (port < 0 || port > NETWORK_MAX_PORT)
@@ -311,6 +371,117 @@ namespace network_cs_ext {
 				sock->set_option(asio::socket_base::keep_alive(value));
 			}
 
+			static int checked_option_value(number value, number max, const char *what)
+			{
+				if (!(value >= 0 && value <= max))
+					throw lang_error(std::string(what) + " must be in range [0, " + std::to_string(static_cast<long long>(max)) + "].");
+				return static_cast<int>(value);
+			}
+
+			bool set_opt_quick_ack(socket_t &sock, bool value)
+			{
+				return sock->set_opt_quick_ack(value);
+			}
+
+			bool set_opt_cork(socket_t &sock, bool value)
+			{
+				return sock->set_opt_cork(value);
+			}
+
+			bool set_opt_notsent_lowat(socket_t &sock, number bytes)
+			{
+				return sock->set_opt_notsent_lowat(checked_option_value(bytes, INT_MAX, "Low watermark"));
+			}
+
+			// Linux caps idle and interval at 32767 seconds and count at 127
+			bool set_opt_keep_alive_params(socket_t &sock, number idle_s, number interval_s, number count)
+			{
+				if (!(idle_s >= 1 && idle_s <= 32767 && interval_s >= 1 && interval_s <= 32767))
+					throw lang_error("Keep-alive idle and interval must be in range [1, 32767] seconds.");
+				if (!(count >= 1 && count <= 127))
+					throw lang_error("Keep-alive probe count must be in range [1, 127].");
+				return sock->set_opt_keep_alive_params(static_cast<int>(idle_s), static_cast<int>(interval_s), static_cast<int>(count));
+			}
+
+			bool set_opt_user_timeout(socket_t &sock, number ms)
+			{
+				return sock->set_opt_user_timeout(checked_option_value(ms, INT_MAX, "User timeout"));
+			}
+
+			bool set_opt_busy_poll(socket_t &sock, number us)
+			{
+				return sock->set_opt_busy_poll(checked_option_value(us, INT_MAX, "Busy poll time"));
+			}
+
+			bool set_opt_fast_open_connect(socket_t &sock, bool value)
+			{
+				return sock->set_opt_fast_open_connect(value);
+			}
+
+			void set_opt_linger(socket_t &sock, bool value, number seconds)
+			{
+				int timeout = checked_option_value(seconds, 65535, "Linger timeout");
+				try {
+					sock->set_option(asio::socket_base::linger(value, timeout));
+				}
+				catch (const std::exception &e) {
+					throw lang_error(e.what());
+				}
+			}
+
+			// Return the size the kernel actually applied, as for UDP sockets
+			number set_opt_receive_buffer(socket_t &sock, number bytes)
+			{
+				if (bytes < 1 || bytes > INT_MAX)
+					throw lang_error("Buffer size must be in range [1, " + std::to_string(INT_MAX) + "].");
+				try {
+					sock->set_option(asio::socket_base::receive_buffer_size(static_cast<int>(bytes)));
+					return sock->get_option<asio::socket_base::receive_buffer_size>().value();
+				}
+				catch (const std::exception &e) {
+					throw lang_error(e.what());
+				}
+			}
+
+			number set_opt_send_buffer(socket_t &sock, number bytes)
+			{
+				if (bytes < 1 || bytes > INT_MAX)
+					throw lang_error("Buffer size must be in range [1, " + std::to_string(INT_MAX) + "].");
+				try {
+					sock->set_option(asio::socket_base::send_buffer_size(static_cast<int>(bytes)));
+					return sock->get_option<asio::socket_base::send_buffer_size>().value();
+				}
+				catch (const std::exception &e) {
+					throw lang_error(e.what());
+				}
+			}
+
+			var tcp_info(socket_t &sock)
+			{
+				cs_impl::network::tcp::connection_info info;
+				try {
+					info = sock->get_connection_info();
+				}
+				catch (const std::exception &e) {
+					throw lang_error(e.what());
+				}
+				hash_map m;
+				m[var::make<string>("state")] = var::make<number>(static_cast<number>(info.state));
+				m[var::make<string>("retransmits")] = var::make<number>(static_cast<number>(info.retransmits));
+				m[var::make<string>("rtt_us")] = var::make<number>(static_cast<number>(info.rtt_us));
+				m[var::make<string>("rttvar_us")] = var::make<number>(static_cast<number>(info.rttvar_us));
+				m[var::make<string>("rto_us")] = var::make<number>(static_cast<number>(info.rto_us));
+				m[var::make<string>("snd_cwnd")] = var::make<number>(static_cast<number>(info.snd_cwnd));
+				m[var::make<string>("snd_ssthresh")] = var::make<number>(static_cast<number>(info.snd_ssthresh));
+				m[var::make<string>("snd_mss")] = var::make<number>(static_cast<number>(info.snd_mss));
+				m[var::make<string>("rcv_mss")] = var::make<number>(static_cast<number>(info.rcv_mss));
+				m[var::make<string>("unacked")] = var::make<number>(static_cast<number>(info.unacked));
+				m[var::make<string>("lost")] = var::make<number>(static_cast<number>(info.lost));
+				m[var::make<string>("total_retrans")] = var::make<number>(static_cast<number>(info.total_retrans));
+				m[var::make<string>("pmtu")] = var::make<number>(static_cast<number>(info.pmtu));
+				return var::make<hash_map>(std::move(m));
+			}
+
 			number available(socket_t &sock)
 			{
 				try {
@@ -326,6 +497,11 @@ namespace network_cs_ext {
 				return sock->peer_closed();
 			}
 
+			number async_jobs(socket_t &sock)
+			{
+				return sock->async_jobs.load(std::memory_order_acquire);
+			}
+
 			string receive(socket_t &sock, number max)
 			{
 				auto size = checked_io_buffer_size(max);
@@ -401,6 +577,70 @@ namespace network_cs_ext {
 			}
 		}
 
+		namespace acpt {
+			static namespace_t acceptor_ext = make_shared_namespace<name_space>();
+
+			number native_handle(acceptor_t &a)
+			{
+				return static_cast<number>(a->native_handle());
+			}
+
+			void set_inheritable(acceptor_t &a, bool value)
+			{
+				try {
+					cs_impl::network::tcp::set_inheritable(*a, value);
+				}
+				catch (const std::exception &e) {
+					throw lang_error(e.what());
+				}
+			}
+
+			bool set_opt_fast_open(acceptor_t &a, number qlen)
+			{
+				if (!(qlen >= 0 && qlen <= INT_MAX))
+					throw lang_error("Fast Open queue length must be in range [0, " + std::to_string(INT_MAX) + "].");
+				return cs_impl::network::tcp::set_fast_open(*a, static_cast<int>(qlen));
+			}
+
+			bool set_opt_defer_accept(acceptor_t &a, number seconds)
+			{
+				if (!(seconds >= 0 && seconds <= INT_MAX))
+					throw lang_error("Defer accept timeout must be in range [0, " + std::to_string(INT_MAX) + "].");
+				return cs_impl::network::tcp::set_defer_accept(*a, static_cast<int>(seconds));
+			}
+
+			var queue_stats(acceptor_t &a)
+			{
+				cs_impl::network::tcp::listen_queue queue;
+				try {
+					queue = cs_impl::network::tcp::get_listen_queue(*a);
+				}
+				catch (const std::exception &e) {
+					throw lang_error(e.what());
+				}
+				hash_map m;
+				m[var::make<string>("queued")] = var::make<number>(static_cast<number>(queue.queued));
+				m[var::make<string>("backlog")] = var::make<number>(static_cast<number>(queue.backlog));
+				return var::make<hash_map>(std::move(m));
+			}
+
+			endpoint_t local_endpoint(acceptor_t &a)
+			{
+				try {
+					return a->local_endpoint();
+				}
+				catch (const std::exception &e) {
+					throw lang_error(e.what());
+				}
+			}
+
+			void close(acceptor_t &a)
+			{
+				asio::error_code ec;
+				a->close(ec);
+			}
+		}
+
 		namespace ep {
 			static namespace_t ep_ext = make_shared_namespace<name_space>();
 
@@ -473,6 +713,29 @@ namespace network_cs_ext {
 			}
 		}
 
+		// Batch limits: at most 1024 datagrams (UIO_MAXIOV), and the
+		// receive buffers (count * size) within NETWORK_MAX_IO_BUFFER_SIZE
+		std::pair<std::size_t, std::size_t> checked_batch_size(number max_count, number max_size)
+		{
+			if (max_count < 1 || max_count > 1024)
+				throw lang_error("Batch size must be in range [1, 1024].");
+			auto count = static_cast<std::size_t>(max_count);
+			auto size = checked_io_buffer_size(max_size);
+			if (count * size > NETWORK_MAX_IO_BUFFER_SIZE)
+				throw lang_error("Batch buffers exceed the " + std::to_string(NETWORK_MAX_IO_BUFFER_SIZE) + " byte limit.");
+			return {count, size};
+		}
+
+		// Array of (payload : endpoint) pairs
+		var batch_to_array(std::vector<cs_impl::network::udp::datagram> &batch)
+		{
+			array arr;
+			for (auto &d : batch)
+				arr.push_back(var::make<cs::pair>(var::make<string>(std::move(d.data)), var::make<endpoint_t>(d.endpoint)));
+			batch.clear();
+			return var::make<array>(std::move(arr));
+		}
+
 		namespace socket {
 			static namespace_t socket_ext = make_shared_namespace<name_space>();
 
@@ -548,6 +811,106 @@ namespace network_cs_ext {
 				sock->set_option(asio::socket_base::broadcast(value));
 			}
 
+			bool set_opt_gro(socket_t &sock, bool value)
+			{
+				return sock->set_opt_gro(value);
+			}
+
+			void join_group(socket_t &sock, const string &group, const string &iface)
+			{
+				try {
+					sock->join_group(group, iface);
+				}
+				catch (const std::exception &e) {
+					throw lang_error(e.what());
+				}
+			}
+
+			void leave_group(socket_t &sock, const string &group, const string &iface)
+			{
+				try {
+					sock->leave_group(group, iface);
+				}
+				catch (const std::exception &e) {
+					throw lang_error(e.what());
+				}
+			}
+
+			void set_opt_multicast_interface(socket_t &sock, const string &iface)
+			{
+				try {
+					sock->set_multicast_interface(iface);
+				}
+				catch (const std::exception &e) {
+					throw lang_error(e.what());
+				}
+			}
+
+			void set_opt_multicast_ttl(socket_t &sock, number ttl)
+			{
+				if (ttl < 0 || ttl > 255)
+					throw lang_error("Multicast TTL must be in range [0, 255].");
+				try {
+					sock->set_option(asio::ip::multicast::hops(static_cast<int>(ttl)));
+				}
+				catch (const std::exception &e) {
+					throw lang_error(e.what());
+				}
+			}
+
+			void set_opt_multicast_loop(socket_t &sock, bool value)
+			{
+				try {
+					sock->set_option(asio::ip::multicast::enable_loopback(value));
+				}
+				catch (const std::exception &e) {
+					throw lang_error(e.what());
+				}
+			}
+
+			// Return the size the kernel actually applied (Linux doubles the
+			// request and caps it at net.core.rmem_max/wmem_max)
+			number set_opt_receive_buffer(socket_t &sock, number bytes)
+			{
+				if (bytes < 1 || bytes > INT_MAX)
+					throw lang_error("Buffer size must be in range [1, " + std::to_string(INT_MAX) + "].");
+				try {
+					sock->set_option(asio::socket_base::receive_buffer_size(static_cast<int>(bytes)));
+					return sock->get_option<asio::socket_base::receive_buffer_size>().value();
+				}
+				catch (const std::exception &e) {
+					throw lang_error(e.what());
+				}
+			}
+
+			number set_opt_send_buffer(socket_t &sock, number bytes)
+			{
+				if (bytes < 1 || bytes > INT_MAX)
+					throw lang_error("Buffer size must be in range [1, " + std::to_string(INT_MAX) + "].");
+				try {
+					sock->set_option(asio::socket_base::send_buffer_size(static_cast<int>(bytes)));
+					return sock->get_option<asio::socket_base::send_buffer_size>().value();
+				}
+				catch (const std::exception &e) {
+					throw lang_error(e.what());
+				}
+			}
+
+			bool set_opt_rxq_ovfl(socket_t &sock, bool value)
+			{
+				return sock->set_opt_rxq_ovfl(value);
+			}
+
+			number dropped(socket_t &sock)
+			{
+				return static_cast<number>(sock->dropped());
+			}
+
+			bool gso_available(socket_t &sock)
+			{
+				return sock->gso_available();
+			}
+
 			number available(socket_t &sock)
 			{
 				try {
@@ -579,6 +942,57 @@ namespace network_cs_ext {
 				}
 			}
 
+			var receive_batch(socket_t &sock, number max_count, number max_size, number timeout_ms)
+			{
+				auto limits = checked_batch_size(max_count, max_size);
+				try {
+					auto batch = sock->receive_batch(limits.first, limits.second, timeout_ms < 0 ? -1 : static_cast<int>(timeout_ms));
+					return batch_to_array(batch);
+				}
+				catch (const std::exception &e) {
+					throw lang_error(e.what());
+				}
+			}
+
+			number send_segmented(socket_t &sock, const string &data, number segment_size, const endpoint_t &ep)
+			{
+				if (segment_size < 1 || segment_size > 65507)
+					throw lang_error("Segment size must be in range [1, 65507].");
+				try {
+					return sock->send_segmented(data, static_cast<std::size_t>(segment_size), ep);
+				}
+				catch (const std::exception &e) {
+					throw lang_error(e.what());
+				}
+			}
+
+			// Each element is a (payload : endpoint) pair or a {payload, endpoint} array
+			number send_batch(socket_t &sock, const array &batch)
+			{
+				std::vector<std::pair<const std::string *, endpoint_t>> items;
+				items.reserve(batch.size());
+				for (auto &item : batch) {
+					const var *payload = nullptr, *ep = nullptr;
+					if (item.is_type_of<cs::pair>()) {
+						payload = &item.const_val<cs::pair>().first;
+						ep = &item.const_val<cs::pair>().second;
+					}
+					else if (item.is_type_of<array>() && item.const_val<array>().size() == 2) {
+						payload = &item.const_val<array>().front();
+						ep = &item.const_val<array>().back();
+					}
+					if (payload == nullptr || !payload->is_type_of<string>() || !ep->is_type_of<endpoint_t>())
+						throw lang_error("Batch elements must be (payload : endpoint) pairs.");
+					items.emplace_back(&payload->const_val<string>(), ep->const_val<endpoint_t>());
+				}
+				try {
+					return sock->send_batch(items);
+				}
+				catch (const std::exception &e) {
+					throw lang_error(e.what());
+				}
+			}
+
 			endpoint_t local_endpoint(socket_t &sock)
 			{
 				try {
@@ -623,6 +1037,469 @@ namespace network_cs_ext {
 				return ep.port();
 			}
 		}
+
+		// Stops the receives when the script drops the receiver
+		struct multi_receiver_holder {
+			std::shared_ptr<cs_impl::network::udp::multi_receiver> impl;
+			~multi_receiver_holder()
+			{
+				if (impl)
+					impl->stop();
+			}
+		};
+
+		using multi_receiver_t = std::shared_ptr<multi_receiver_holder>;
+
+		var multi_receiver(socket_t &sock, number count, number max_size, number capacity)
+		{
+			auto limits = checked_batch_size(count, max_size);
+			if (capacity < 1)
+				throw lang_error("Queue capacity must be greater than zero.");
+			try {
+				auto impl = std::make_shared<cs_impl::network::udp::multi_receiver>(
+				                sock, limits.first, limits.second, static_cast<std::size_t>(capacity));
+				auto holder = std::make_shared<multi_receiver_holder>();
+				holder->impl = impl;
+				impl->start();
+				return var::make<multi_receiver_t>(holder);
+			}
+			catch (const std::exception &e) {
+				throw lang_error(e.what());
+			}
+		}
+
+		namespace mr {
+			static namespace_t multi_receiver_ext = make_shared_namespace<name_space>();
+
+			var receive(multi_receiver_t &r, number max_count)
+			{
+				if (max_count < 1)
+					throw lang_error("Batch size must be greater than zero.");
+				auto batch = r->impl->take(static_cast<std::size_t>(max_count));
+				return batch_to_array(batch);
+			}
+
+			bool wait_for(multi_receiver_t &, number);
+
+			bool stop(multi_receiver_t &);
+
+			number size(multi_receiver_t &r)
+			{
+				return r->impl->size();
+			}
+
+			number overflow(multi_receiver_t &r)
+			{
+				return static_cast<number>(r->impl->overflow());
+			}
+
+			var error(multi_receiver_t &r)
+			{
+				auto message = r->impl->error();
+				if (message.empty())
+					return null_pointer;
+				return var::make<string>(message);
+			}
+		}
+	}
+
+	// HTTP routing
+
+	namespace http {
+		static namespace_t http_ext = make_shared_namespace<name_space>();
+		using router_t = std::shared_ptr<cs_impl::network::http::router>;
+
+		router_t router()
+		{
+			return std::make_shared<cs_impl::network::http::router>();
+		}
+
+		string date()
+		{
+			return cs_impl::network::http::get_date_cache().get();
+		}
+
+		// Size of a file in bytes without reading it, -1 if it does not exist
+		number file_size(const string &path)
+		{
+			std::error_code ec;
+			auto size = std::filesystem::file_size(path, ec);
+			if (ec)
+				return -1;
+			return static_cast<number>(size);
+		}
+
+		using access_log_t = std::shared_ptr<cs_impl::network::http::access_log>;
+
+		var access_log(const string &path, number capacity, number flush_ms)
+		{
+			if (capacity < 1)
+				throw lang_error("Access log capacity must be greater than zero.");
+			if (flush_ms < 1)
+				throw lang_error("Access log flush interval must be greater than zero.");
+			try {
+				return var::make<access_log_t>(std::make_shared<cs_impl::network::http::access_log>(
+				                                   path, static_cast<std::size_t>(capacity), static_cast<std::size_t>(flush_ms)));
+			}
+			catch (const std::exception &e) {
+				throw lang_error(e.what());
+			}
+		}
+
+		namespace alog {
+			static namespace_t access_log_ext = make_shared_namespace<name_space>();
+
+			void set_format(access_log_t &log, const string &format)
+			{
+				if (format == "combined")
+					log->set_format(cs_impl::network::http::access_log::format_type::combined);
+				else if (format == "json")
+					log->set_format(cs_impl::network::http::access_log::format_type::json);
+				else
+					throw lang_error("Unsupported access log format: " + format);
+			}
+
+			void set_overflow(access_log_t &log, const string &policy)
+			{
+				if (policy == "drop")
+					log->set_blocking(false);
+				else if (policy == "block")
+					log->set_blocking(true);
+				else
+					throw lang_error("Unsupported access log overflow policy: " + policy);
+			}
+
+			bool push(access_log_t &log, std::string &line)
+			{
+				using push_result = cs_impl::network::http::access_log::push_result;
+				push_result result = log->push(line);
+				if (result == push_result::full && log->blocking()) {
+					// Backpressure: wake the writer and wait for a free slot,
+					// giving up if the log is closed meanwhile
+					do {
+						log->notify();
+						cs_runtime_yield();
+						result = log->push(line);
+					}
+					while (result == push_result::full);
+				}
+				if (result == push_result::queued)
+					return true;
+				if (result == push_result::full)
+					log->count_drop();
+				return false;
+			}
+
+			bool write(access_log_t &log, const string &line)
+			{
+				std::string copy = line;
+				return push(log, copy);
+			}
+
+			bool access(access_log_t &log, const hash_map &fields)
+			{
+				cs_impl::network::http::access_log::entry e;
+				for (const auto &it : fields) {
+					if (!it.first.is_type_of<string>())
+						throw lang_error("Access log field names must be strings.");
+					const auto &key = it.first.const_val<string>();
+					const auto &value = it.second;
+					if (key == "bytes" || key == "latency") {
+						if (!value.is_type_of<numeric>())
+							throw lang_error("Access log field \"" + key + "\" must be a number.");
+						double num = value.const_val<numeric>().as_float();
+						if (key == "bytes")
+							e.bytes = num < 0 ? 0 : static_cast<std::size_t>(num);
+						else
+							e.latency_ms = num;
+						continue;
+					}
+					if (is_null_var(value))
+						continue;
+					if (!value.is_type_of<string>())
+						throw lang_error("Access log field \"" + key + "\" must be a string.");
+					const auto &str = value.const_val<string>();
+					if (key == "remote")
+						e.remote = str;
+					else if (key == "method")
+						e.method = str;
+					else if (key == "target")
+						e.target = str;
+					else if (key == "version")
+						e.version = str;
+					else if (key == "status")
+						e.status = str;
+					else if (key == "referer")
+						e.referer = str;
+					else if (key == "user_agent")
+						e.user_agent = str;
+					else
+						throw lang_error("Unknown access log field: " + key);
+				}
+				std::string line = log->format(e);
+				return push(log, line);
+			}
+
+			// Wait until everything queued so far has been written
+			void flush(access_log_t &log)
+			{
+				std::size_t target = log->queued();
+				while (!log->flushed(target) && !log->closed()) {
+					log->notify();
+					cs_runtime_yield();
+				}
+			}
+
+			number dropped(access_log_t &log)
+			{
+				return log->dropped_count();
+			}
+
+			void close(access_log_t &log)
+			{
+				log->close();
+			}
+		}
+
+		using rate_limiter_t = std::shared_ptr<cs_impl::network::http::rate_limiter>;
+
+		var rate_limiter(number rate, number burst, number max_keys)
+		{
+			if (max_keys < 1)
+				throw lang_error("Rate limiter key capacity must be greater than zero.");
+			try {
+				return var::make<rate_limiter_t>(std::make_shared<cs_impl::network::http::rate_limiter>(
+				                                     rate, burst, static_cast<std::size_t>(max_keys)));
+			}
+			catch (const std::exception &e) {
+				throw lang_error(e.what());
+			}
+		}
+
+		namespace rl {
+			static namespace_t rate_limiter_ext = make_shared_namespace<name_space>();
+
+			// 0 if admitted, otherwise whole seconds to wait (a Retry-After value)
+			static number retry_after(double wait_ms)
+			{
+				if (wait_ms <= 0)
+					return 0;
+				return (std::max)(std::ceil(wait_ms / 1000), 1.0);
+			}
+
+			number acquire(rate_limiter_t &l, const string &key)
+			{
+				return retry_after(l->acquire(key));
+			}
+
+			number acquire_n(rate_limiter_t &l, const string &key, number cost)
+			{
+				if (cost < 0)
+					throw lang_error("Rate limiter cost must not be negative.");
+				// A bucket never holds more than burst tokens, so a larger
+				// cost would be told to retry forever
+				if (cost > l->get_burst())
+					throw lang_error("Rate limiter cost must not exceed the burst size.");
+				return retry_after(l->acquire(key, cost));
+			}
+
+			// Keyed by the raw bytes of the peer address (IPv4-mapped IPv6
+			// folded to IPv4), so no string formatting per request. Sockets
+			// without a peer are admitted.
+			number acquire_peer(rate_limiter_t &l, tcp::socket_t &sock)
+			{
+				asio::error_code ec;
+				auto ep = sock->get_raw().remote_endpoint(ec);
+				if (ec)
+					return 0;
+				auto addr = ep.address();
+				std::string key;
+				if (addr.is_v6() && addr.to_v6().is_v4_mapped())
+					addr = asio::ip::make_address_v4(asio::ip::v4_mapped, addr.to_v6());
+				if (addr.is_v4()) {
+					auto bytes = addr.to_v4().to_bytes();
+					key.assign(bytes.begin(), bytes.end());
+				}
+				else {
+					auto bytes = addr.to_v6().to_bytes();
+					key.assign(bytes.begin(), bytes.end());
+				}
+				return retry_after(l->acquire(key));
+			}
+
+			number size(rate_limiter_t &l)
+			{
+				return l->size();
+			}
+
+			void clear(rate_limiter_t &l)
+			{
+				l->clear();
+			}
+		}
+
+		namespace rt {
+			static namespace_t router_ext = make_shared_namespace<name_space>();
+
+			void add(router_t &r, const string &method, const string &pattern, const string &route)
+			{
+				try {
+					r->add(method, pattern, route);
+				}
+				catch (const std::exception &e) {
+					throw lang_error(e.what());
+				}
+			}
+
+			var match(router_t &r, const string &method, const string &path)
+			{
+				cs_impl::network::http::router::match_result result;
+				if (!r->match(method, path, result))
+					return null_pointer;
+				hash_map params;
+				for (auto &param : result.params)
+					params[var::make<string>(param.first)] = var::make<string>(param.second);
+				hash_map m;
+				m[var::make<string>("route")] = var::make<string>(result.route);
+				m[var::make<string>("params")] = var::make<hash_map>(std::move(params));
+				m[var::make<string>("exact")] = var::make<boolean>(result.exact);
+				return var::make<hash_map>(std::move(m));
+			}
+
+			var allowed(router_t &r, const string &path)
+			{
+				array methods;
+				for (auto &method : r->allowed(path))
+					methods.push_back(var::make<string>(method));
+				return var::make<array>(std::move(methods));
+			}
+
+			number size(router_t &r)
+			{
+				return r->size();
+			}
+		}
+	}
+
+	// Metrics
+
+	namespace metrics {
+		static namespace_t metrics_ext = make_shared_namespace<name_space>();
+
+		cs_impl::network::metrics::registry &registry()
+		{
+			return cs_impl::network::metrics::get_registry();
+		}
+
+		std::uint64_t checked_sample(number value)
+		{
+			if (value < 0)
+				throw lang_error("Metric value must not be negative.");
+			return static_cast<std::uint64_t>(value);
+		}
+
+		void counter_add(const string &name, number value)
+		{
+			auto n = checked_sample(value);
+			try {
+				registry().get_counter(name).add(n);
+			}
+			catch (const std::exception &e) {
+				throw lang_error(e.what());
+			}
+		}
+
+		void gauge_set(const string &name, number value)
+		{
+			try {
+				registry().get_gauge(name).set(static_cast<std::int64_t>(value));
+			}
+			catch (const std::exception &e) {
+				throw lang_error(e.what());
+			}
+		}
+
+		void gauge_add(const string &name, number delta)
+		{
+			try {
+				registry().get_gauge(name).inc(static_cast<std::int64_t>(delta));
+			}
+			catch (const std::exception &e) {
+				throw lang_error(e.what());
+			}
+		}
+
+		void observe(const string &name, number value)
+		{
+			auto n = checked_sample(value);
+			try {
+				registry().get_histogram(name).record(n);
+			}
+			catch (const std::exception &e) {
+				throw lang_error(e.what());
+			}
+		}
+
+		void describe(const string &name, const string &help)
+		{
+			try {
+				registry().set_help(name, help);
+			}
+			catch (const std::exception &e) {
+				throw lang_error(e.what());
+			}
+		}
+
+		// Host-wide gauges are read when metrics are exported
+		static void sample_host_metrics()
+		{
+			std::uint64_t overflows = 0, drops = 0;
+			if (cs_impl::network::tcp::read_listen_counters(overflows, drops)) {
+				auto &stats = cs_impl::network::metrics::builtin();
+				stats.tcp_listen_overflows.set(static_cast<std::int64_t>(overflows));
+				stats.tcp_listen_drops.set(static_cast<std::int64_t>(drops));
+			}
+		}
+
+		// Counters and gauges map to numbers, histograms to a summary map
+		var snapshot()
+		{
+			sample_host_metrics();
+			hash_map m;
+			registry().each([&m](const std::string &name, const cs_impl::network::metrics::counter *c,
+			                     const cs_impl::network::metrics::gauge *g, const cs_impl::network::metrics::histogram *h) {
+				if (c)
+					m[var::make<string>(name)] = var::make<number>(static_cast<number>(c->value()));
+				else if (g)
+					m[var::make<string>(name)] = var::make<number>(static_cast<number>(g->value()));
+				else if (h) {
+					hash_map s;
+					s[var::make<string>("count")] = var::make<number>(static_cast<number>(h->count()));
+					s[var::make<string>("sum")] = var::make<number>(static_cast<number>(h->sum()));
+					s[var::make<string>("min")] = var::make<number>(static_cast<number>(h->min()));
+					s[var::make<string>("max")] = var::make<number>(static_cast<number>(h->max()));
+					s[var::make<string>("p50")] = var::make<number>(static_cast<number>(h->percentile(0.5)));
+					s[var::make<string>("p90")] = var::make<number>(static_cast<number>(h->percentile(0.9)));
+					s[var::make<string>("p99")] = var::make<number>(static_cast<number>(h->percentile(0.99)));
+					s[var::make<string>("p999")] = var::make<number>(static_cast<number>(h->percentile(0.999)));
+					m[var::make<string>(name)] = var::make<hash_map>(std::move(s));
+				}
+			});
+			return var::make<hash_map>(std::move(m));
+		}
+
+		string prometheus()
+		{
+			sample_host_metrics();
+			return registry().prometheus();
+		}
+
+		// Monotonic clock in microseconds for timing spans
+		number now_us()
+		{
+			return static_cast<number>(std::chrono::duration_cast<std::chrono::microseconds>(
+			                               std::chrono::steady_clock::now().time_since_epoch()).count());
+		}
 	}
 
 	// Asynchronous
@@ -738,6 +1615,19 @@ namespace network_cs_ext {
 			}
 		};
 
+		// Ids of watched states whose operation has completed, in completion
+		// order; filled from the I/O threads, drained by fibers.
+		struct ready_queue_type {
+			std::mutex mutex;
+			std::deque<number> ready;
+
+			void push(number id)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				ready.push_back(id);
+			}
+		};
+
 		struct state_type {
 			bool init = false;
 			bool is_udp = false;
@@ -747,6 +1637,38 @@ namespace network_cs_ext {
 			udp::endpoint_t udp_endpoint;
 			asio::streambuf buffer;
 			asio::error_code ec;
+			// Datagrams of async.receive_batch
+			bool is_batch = false;
+			std::vector<cs_impl::network::udp::datagram> batch;
+			// Connections taken by async.accept_batch
+			bool is_accept_batch = false;
+			std::vector<tcp::socket_t> accepted;
+			// Endpoints of async.resolve
+			bool is_resolve = false;
+			std::vector<tcp::endpoint_t> endpoints;
+			// Winning endpoint of async.connect_any
+			bool is_connect_any = false;
+			tcp::endpoint_t winner;
+			// One-shot completion notification armed by ready_queue.watch
+			std::mutex notify_mutex;
+			std::weak_ptr<ready_queue_type> notify;
+			number notify_id = 0;
+
+			// Publish has_done, then hand the id to the watching queue
+			void publish()
+			{
+				has_done.store(true, std::memory_order_release);
+				std::shared_ptr<ready_queue_type> queue;
+				number id = 0;
+				{
+					std::lock_guard<std::mutex> lock(notify_mutex);
+					queue = notify.lock();
+					notify.reset();
+					id = notify_id;
+				}
+				if (queue)
+					queue->push(id);
+			}
 		};
 
 		using state_t = std::shared_ptr<state_type>;
@@ -808,6 +1730,13 @@ namespace network_cs_ext {
 			return state->ec == asio::error::eof || state->ec == asio::error::connection_reset;
 		}
 
+		bool timed_out(const state_t &state)
+		{
+			if (!state->has_done.load(std::memory_order_acquire))
+				return false;
+			return state->ec == asio::error::timed_out;
+		}
+
 		cs::var get_error(const state_t &state)
 		{
 			if (!state->has_done.load(std::memory_order_acquire))
@@ -844,88 +1773,542 @@ namespace network_cs_ext {
 			}
 		}
 
-		bool wait(const state_t &state)
+		bool wait(const state_t &state)
+		{
+			return wait_impl(state, std::nullopt);
+		}
+
+		bool wait_for(const state_t &state, std::size_t timeout_ms)
+		{
+			return wait_impl(state, std::chrono::milliseconds(timeout_ms));
+		}
+
+		using ready_queue_t = std::shared_ptr<ready_queue_type>;
+
+		ready_queue_t create_ready_queue()
+		{
+			return std::make_shared<ready_queue_type>();
+		}
+
+		static namespace_t ready_queue_ext = make_shared_namespace<name_space>();
+
+		namespace rq {
+			// Queue id once the pending operation on state completes (at
+			// once if it already has); one notification per watch
+			void watch(const ready_queue_t &queue, const state_t &state, number id)
+			{
+				std::lock_guard<std::mutex> lock(state->notify_mutex);
+				if (state->has_done.load(std::memory_order_acquire)) {
+					state->notify.reset();
+					queue->push(id);
+				}
+				else {
+					state->notify = queue;
+					state->notify_id = id;
+				}
+			}
+
+			void push(const ready_queue_t &queue, number id)
+			{
+				queue->push(id);
+			}
+
+			var pop(const ready_queue_t &queue)
+			{
+				std::lock_guard<std::mutex> lock(queue->mutex);
+				if (queue->ready.empty())
+					return cs::null_pointer;
+				number id = queue->ready.front();
+				queue->ready.pop_front();
+				return id;
+			}
+
+			number size(const ready_queue_t &queue)
+			{
+				std::lock_guard<std::mutex> lock(queue->mutex);
+				return queue->ready.size();
+			}
+
+			bool empty(const ready_queue_t &queue)
+			{
+				std::lock_guard<std::mutex> lock(queue->mutex);
+				return queue->ready.empty();
+			}
+		}
+
+		static namespace_t async_ext = make_shared_namespace<name_space>();
+
+		// Completion handlers settle the pending gauge and the error and
+		// byte counters before publishing has_done.
+		static cs_impl::network::metrics::builtin_metrics &stats()
+		{
+			return cs_impl::network::metrics::builtin();
+		}
+
+		static void settle(const asio::error_code &ec)
+		{
+			stats().async_pending.dec();
+			if (ec)
+				stats().async_errors.add();
+		}
+
+		template <typename BeginOperation>
+		void begin_tcp_async_io(BeginOperation &&begin_operation)
+		{
+			try {
+				begin_operation();
+			}
+			catch (const std::exception &e) {
+				throw cs::lang_error(e.what());
+			}
+		}
+
+		template <typename BeginOperation>
+		void begin_udp_async_io(BeginOperation &&begin_operation)
+		{
+			try {
+				begin_operation();
+			}
+			catch (const std::exception &e) {
+				throw cs::lang_error(e.what());
+			}
+		}
+
+		/*
+		 * Per-operation deadline of the *_for variants. The operation's
+		 * completion handler and a steady_timer share a strand (the TLS
+		 * strand for TLS sockets); on expiry the timer emits a terminal
+		 * cancellation on the operation's slot, so the reactor drops just
+		 * that operation and it completes with asio::error::timed_out.
+		 * Serializing on the strand keeps the signal, the slot (re-armed by
+		 * each step of a composed read or write) and the timer race-free.
+		 */
+		struct deadline_type {
+			asio::strand<asio::io_context::executor_type> strand;
+			asio::steady_timer timer;
+			asio::cancellation_signal signal;
+			std::chrono::milliseconds timeout;
+			// Strand only
+			bool expired = false;
+
+			deadline_type(const asio::strand<asio::io_context::executor_type> &s, std::chrono::milliseconds t)
+				: strand(s), timer(cs_impl::network::get_io_context()), timeout(t) {}
+		};
+
+		using deadline_t = std::shared_ptr<deadline_type>;
+
+		static std::chrono::milliseconds checked_timeout(number timeout_ms)
+		{
+			if (!(timeout_ms >= 0))
+				throw cs::lang_error("Timeout must not be negative.");
+			return std::chrono::milliseconds(static_cast<long long>(timeout_ms));
+		}
+
+		static deadline_t make_deadline(const tcp::socket_t &sock, std::optional<std::chrono::milliseconds> timeout)
+		{
+			if (!timeout.has_value())
+				return nullptr;
+			return std::make_shared<deadline_type>(
+			           sock->is_ssl() ? sock->get_tls_strand() : asio::make_strand(cs_impl::network::get_io_context()), *timeout);
+		}
+
+		// Handler bound to the deadline's strand and cancellation slot
+		template <typename Handler>
+		static auto bind_deadline(const deadline_t &deadline, Handler &&handler)
 		{
-			return wait_impl(state, std::nullopt);
+			return asio::bind_cancellation_slot(deadline->signal.slot(),
+			                                    asio::bind_executor(deadline->strand, std::forward<Handler>(handler)));
 		}
 
-		bool wait_for(const state_t &state, std::size_t timeout_ms)
+		// Call after initiating the operation
+		static void arm_deadline(const deadline_t &deadline, const state_t &state)
 		{
-			return wait_impl(state, std::chrono::milliseconds(timeout_ms));
+			if (!deadline)
+				return;
+			asio::post(deadline->strand, [deadline, state] {
+				if (state->has_done.load(std::memory_order_acquire))
+					return;
+				deadline->timer.expires_after(deadline->timeout);
+				deadline->timer.async_wait(asio::bind_executor(deadline->strand, [deadline, state](const asio::error_code &ec) {
+					if (ec || state->has_done.load(std::memory_order_acquire))
+						return;
+					deadline->expired = true;
+					deadline->signal.emit(asio::cancellation_type::terminal);
+				}));
+			});
 		}
 
-		static namespace_t async_ext = make_shared_namespace<name_space>();
+		// First thing in the completion handler: stops the timer and
+		// reports a cancelled expired operation as timed_out
+		static void settle_deadline(const deadline_t &deadline, asio::error_code &ec)
+		{
+			if (!deadline)
+				return;
+			deadline->timer.cancel();
+			if (deadline->expired && ec)
+				ec = asio::error::timed_out;
+		}
 
-		template <typename BeginOperation>
-		void begin_tcp_async_io(BeginOperation &&begin_operation)
+		void begin_tcp_tls_handshake(const tcp::socket_t &sock)
 		{
 			try {
-				begin_operation();
+				sock->begin_tls_handshake();
 			}
 			catch (const std::exception &e) {
 				throw cs::lang_error(e.what());
 			}
 		}
 
-		template <typename BeginOperation>
-		void begin_udp_async_io(BeginOperation &&begin_operation)
+		state_t accept_impl(tcp::socket_t &sock, tcp::acceptor_t &acceptor, std::optional<std::chrono::milliseconds> timeout)
 		{
+			state_t state = std::make_shared<state_type>();
+			state->init = true;
+			begin_tcp_async_io([&sock] { sock->begin_async_connect(); });
+			stats().async_pending.inc();
+			deadline_t deadline;
 			try {
-				begin_operation();
+				deadline = make_deadline(sock, timeout);
+				auto on_done = [sock, state, deadline](asio::error_code ec) {
+					settle_deadline(deadline, ec);
+					settle(ec);
+					if (!ec)
+						stats().tcp_accepts.add();
+					state->ec = ec;
+					sock->end_async_connect();
+					state->publish();
+				};
+				if (deadline)
+					acceptor->async_accept(sock->get_raw(), bind_deadline(deadline, on_done));
+				else
+					acceptor->async_accept(sock->get_raw(), on_done);
 			}
-			catch (const std::exception &e) {
-				throw cs::lang_error(e.what());
+			catch (...) {
+				stats().async_pending.dec();
+				sock->end_async_connect();
+				throw;
 			}
+			arm_deadline(deadline, state);
+			return state;
 		}
 
-		void begin_tcp_tls_handshake(const tcp::socket_t &sock)
+		state_t accept(tcp::socket_t &sock, tcp::acceptor_t &acceptor)
+		{
+			return accept_impl(sock, acceptor, std::nullopt);
+		}
+
+		state_t accept_for(tcp::socket_t &sock, tcp::acceptor_t &acceptor, number timeout_ms)
+		{
+			return accept_impl(sock, acceptor, checked_timeout(timeout_ms));
+		}
+
+		// Wait for the listener to become readable, then drain its queue.
+		// A wakeup whose connections were taken by another waiter re-arms.
+		static void wait_accept_batch(const tcp::acceptor_t &acceptor, const state_t &state, std::size_t max_count)
+		{
+			acceptor->async_wait(asio::ip::tcp::acceptor::wait_read, [acceptor, state, max_count](asio::error_code ec) {
+				if (!ec) {
+					cs_impl::network::tcp::accept_ready(*acceptor, max_count, state->accepted, ec);
+					if (!ec && state->accepted.empty()) {
+						wait_accept_batch(acceptor, state, max_count);
+						return;
+					}
+				}
+				settle(ec);
+				if (!ec)
+					stats().tcp_accept_batches.add();
+				state->ec = ec;
+				state->publish();
+			});
+		}
+
+		/*
+		 * Accept every connection pending on the listener, up to max_count,
+		 * per readiness event instead of one per async.accept. Connections
+		 * already queued are taken at once without waiting.
+		 */
+		state_t accept_batch(tcp::acceptor_t &acceptor, number max_count)
 		{
+			if (max_count < 1 || max_count > 1024)
+				throw cs::lang_error("Batch size must be in range [1, 1024].");
+			state_t state = std::make_shared<state_type>();
+			state->init = true;
+			state->is_accept_batch = true;
+			auto count = static_cast<std::size_t>(max_count);
+			asio::error_code ec;
 			try {
-				sock->begin_tls_handshake();
+				// Sync accept() keeps its blocking behaviour: asio polls for
+				// it when only the native descriptor is non-blocking
+				acceptor->native_non_blocking(true);
+				cs_impl::network::tcp::accept_ready(*acceptor, count, state->accepted, ec);
+			}
+			catch (const std::exception &e) {
+				throw cs::lang_error(e.what());
+			}
+			if (ec || !state->accepted.empty()) {
+				if (ec)
+					stats().async_errors.add();
+				else
+					stats().tcp_accept_batches.add();
+				state->ec = ec;
+				state->publish();
+				return state;
+			}
+			stats().async_pending.inc();
+			try {
+				wait_accept_batch(acceptor, state, count);
 			}
 			catch (const std::exception &e) {
+				stats().async_pending.dec();
 				throw cs::lang_error(e.what());
 			}
+			return state;
 		}
 
-		state_t accept(tcp::socket_t &sock, tcp::acceptor_t &acceptor)
+		// Consuming: later calls return only sockets taken since
+		cs::var get_sockets(const state_t &state)
+		{
+			if (!state->is_accept_batch)
+				throw cs::lang_error("Asynchronous operation not an accept_batch session.");
+			if (!state->has_done.load(std::memory_order_acquire))
+				return cs::null_pointer;
+			cs::var ret = cs::var::make<cs::array>();
+			cs::array &arr = ret.val<cs::array>();
+			for (auto &sock : state->accepted)
+				arr.push_back(cs::var::make<tcp::socket_t>(std::move(sock)));
+			state->accepted.clear();
+			return ret;
+		}
+
+		state_t connect_impl(tcp::socket_t &sock, const tcp::endpoint_t &ep, std::optional<std::chrono::milliseconds> timeout)
 		{
 			state_t state = std::make_shared<state_type>();
 			state->init = true;
 			begin_tcp_async_io([&sock] { sock->begin_async_connect(); });
+			stats().async_pending.inc();
+			deadline_t deadline;
 			try {
-				acceptor->async_accept(sock->get_raw(), [sock, state](const asio::error_code &ec) {
+				deadline = make_deadline(sock, timeout);
+				auto on_done = [sock, state, deadline](asio::error_code ec) {
+					settle_deadline(deadline, ec);
+					settle(ec);
+					if (!ec)
+						stats().tcp_connects.add();
 					state->ec = ec;
 					sock->end_async_connect();
-					state->has_done.store(true, std::memory_order_release);
-				});
+					state->publish();
+				};
+				if (deadline)
+					sock->get_raw().async_connect(ep, bind_deadline(deadline, on_done));
+				else
+					sock->get_raw().async_connect(ep, on_done);
 			}
 			catch (...) {
+				stats().async_pending.dec();
 				sock->end_async_connect();
 				throw;
 			}
+			arm_deadline(deadline, state);
 			return state;
 		}
 
 		state_t connect(tcp::socket_t &sock, const tcp::endpoint_t &ep)
+		{
+			return connect_impl(sock, ep, std::nullopt);
+		}
+
+		state_t connect_for(tcp::socket_t &sock, const tcp::endpoint_t &ep, number timeout_ms)
+		{
+			return connect_impl(sock, ep, checked_timeout(timeout_ms));
+		}
+
+		/*
+		 * Happy Eyeballs (RFC 8305) connection race. Attempts start in
+		 * address-family-interleaved order, a new one every stagger_ms or
+		 * as soon as all running attempts have failed. Each attempt owns a
+		 * socket; the first to connect is moved into the target socket and
+		 * the others are closed, which cancels them. An optional deadline
+		 * closes every attempt and completes the race with timed_out.
+		 * Everything runs on the race's strand.
+		 */
+		struct connect_race : std::enable_shared_from_this<connect_race> {
+			asio::strand<asio::io_context::executor_type> strand;
+			asio::steady_timer stagger_timer;
+			asio::steady_timer deadline_timer;
+			std::chrono::milliseconds stagger;
+			tcp::socket_t sock;
+			state_t state;
+			std::vector<tcp::endpoint_t> endpoints;
+			std::vector<std::unique_ptr<asio::ip::tcp::socket>> attempts;
+			std::size_t failed = 0;
+			bool done = false;
+			asio::error_code last_error;
+
+			connect_race(tcp::socket_t s, state_t st, std::vector<tcp::endpoint_t> eps, std::chrono::milliseconds delay)
+				: strand(asio::make_strand(cs_impl::network::get_io_context())),
+				  stagger_timer(cs_impl::network::get_io_context()),
+				  deadline_timer(cs_impl::network::get_io_context()), stagger(delay),
+				  sock(std::move(s)), state(std::move(st)), endpoints(std::move(eps)) {}
+
+			void start(std::optional<std::chrono::milliseconds> timeout)
+			{
+				if (timeout) {
+					deadline_timer.expires_after(*timeout);
+					deadline_timer.async_wait(asio::bind_executor(strand, [self = shared_from_this()](const asio::error_code &ec) {
+						if (!ec && !self->done) {
+							self->close_attempts(self->attempts.size());
+							self->finish(asio::error::timed_out);
+						}
+					}));
+				}
+				start_next();
+			}
+
+			void close_attempts(std::size_t keep)
+			{
+				asio::error_code ignored;
+				for (std::size_t i = 0; i < attempts.size(); ++i) {
+					if (i != keep)
+						attempts[i]->close(ignored);
+				}
+			}
+
+			void start_next()
+			{
+				if (done || attempts.size() >= endpoints.size())
+					return;
+				std::size_t index = attempts.size();
+				attempts.emplace_back(new asio::ip::tcp::socket(cs_impl::network::get_io_context()));
+				asio::error_code ec;
+				attempts[index]->open(endpoints[index].protocol(), ec);
+				if (ec) {
+					asio::post(strand, [self = shared_from_this(), index, ec] { self->on_result(index, ec); });
+				}
+				else {
+					attempts[index]->async_connect(endpoints[index], asio::bind_executor(strand,
+					[self = shared_from_this(), index](const asio::error_code &ec) {
+						self->on_result(index, ec);
+					}));
+				}
+				if (attempts.size() < endpoints.size()) {
+					stagger_timer.expires_after(stagger);
+					stagger_timer.async_wait(asio::bind_executor(strand, [self = shared_from_this()](const asio::error_code &ec) {
+						if (!ec)
+							self->start_next();
+					}));
+				}
+			}
+
+			void on_result(std::size_t index, const asio::error_code &ec)
+			{
+				if (done)
+					return;
+				if (!ec) {
+					close_attempts(index);
+					sock->get_raw() = std::move(*attempts[index]);
+					state->winner = endpoints[index];
+					finish(ec);
+					return;
+				}
+				last_error = ec;
+				if (++failed == endpoints.size())
+					finish(last_error);
+				else if (failed == attempts.size()) {
+					// Every started attempt failed: skip the rest of the delay
+					stagger_timer.cancel();
+					start_next();
+				}
+			}
+
+			void finish(const asio::error_code &ec)
+			{
+				done = true;
+				stagger_timer.cancel();
+				deadline_timer.cancel();
+				settle(ec);
+				if (!ec)
+					stats().tcp_connects.add();
+				state->ec = ec;
+				sock->end_async_connect();
+				state->publish();
+			}
+		};
+
+		// RFC 8305 section 4: alternate address families, keeping the
+		// resolver's order within each family and starting with the first
+		static std::vector<tcp::endpoint_t> interleave_families(const std::vector<tcp::endpoint_t> &endpoints)
+		{
+			std::vector<tcp::endpoint_t> first, second, out;
+			bool first_v6 = !endpoints.empty() && endpoints.front().address().is_v6();
+			for (auto &ep : endpoints)
+				(ep.address().is_v6() == first_v6 ? first : second).push_back(ep);
+			for (std::size_t i = 0; i < first.size() || i < second.size(); ++i) {
+				if (i < first.size())
+					out.push_back(first[i]);
+				if (i < second.size())
+					out.push_back(second[i]);
+			}
+			return out;
+		}
+
+		state_t connect_any_impl(tcp::socket_t &sock, std::vector<tcp::endpoint_t> endpoints, std::chrono::milliseconds stagger,
+		                         std::optional<std::chrono::milliseconds> timeout)
 		{
 			state_t state = std::make_shared<state_type>();
 			state->init = true;
+			state->is_connect_any = true;
 			begin_tcp_async_io([&sock] { sock->begin_async_connect(); });
+			stats().async_pending.inc();
 			try {
-				sock->get_raw().async_connect(ep, [sock, state](const asio::error_code &ec) {
-					state->ec = ec;
-					sock->end_async_connect();
-					state->has_done.store(true, std::memory_order_release);
-				});
+				auto race = std::make_shared<connect_race>(sock, state, interleave_families(endpoints), stagger);
+				asio::post(race->strand, [race, timeout] { race->start(timeout); });
 			}
 			catch (...) {
+				stats().async_pending.dec();
 				sock->end_async_connect();
 				throw;
 			}
 			return state;
 		}
 
+		static std::vector<tcp::endpoint_t> checked_endpoints(const cs::array &endpoints, number stagger_ms)
+		{
+			if (!(stagger_ms >= 0))
+				throw cs::lang_error("Stagger delay must not be negative.");
+			std::vector<tcp::endpoint_t> eps;
+			for (auto &ep : endpoints) {
+				if (!ep.is_type_of<tcp::endpoint_t>())
+					throw cs::lang_error("connect_any expects an array of TCP endpoints.");
+				eps.push_back(ep.const_val<tcp::endpoint_t>());
+			}
+			if (eps.empty())
+				throw cs::lang_error("connect_any needs at least one endpoint.");
+			return eps;
+		}
+
+		state_t connect_any(tcp::socket_t &sock, const cs::array &endpoints, number stagger_ms)
+		{
+			auto eps = checked_endpoints(endpoints, stagger_ms);
+			return connect_any_impl(sock, std::move(eps), std::chrono::milliseconds(static_cast<long long>(stagger_ms)), std::nullopt);
+		}
+
+		state_t connect_any_for(tcp::socket_t &sock, const cs::array &endpoints, number stagger_ms, number timeout_ms)
+		{
+			auto eps = checked_endpoints(endpoints, stagger_ms);
+			auto timeout = checked_timeout(timeout_ms);
+			return connect_any_impl(sock, std::move(eps), std::chrono::milliseconds(static_cast<long long>(stagger_ms)), timeout);
+		}
+
+		tcp::endpoint_t get_winner(const state_t &state)
+		{
+			if (!state->is_connect_any)
+				throw cs::lang_error("Asynchronous operation not a connect_any session.");
+			if (!state->has_done.load(std::memory_order_acquire))
+				throw cs::lang_error("Asynchronous operation not finished.");
+			if (state->ec)
+				throw cs::lang_error("Asynchronous operation has encountered an error: " + state->ec.message());
+			return state->winner;
+		}
+
 		state_t connect_ssl(tcp::socket_t &sock, const std::string &host, const cs::var &options)
 		{
 			state_t state = std::make_shared<state_type>();
@@ -939,17 +2322,27 @@ namespace network_cs_ext {
 				sock->end_tls_handshake();
 				throw cs::lang_error(e.what());
 			}
+			stats().async_pending.inc();
 			try {
+				auto started = std::chrono::steady_clock::now();
 				sock->get_tls_raw().async_handshake(asio::ssl::stream_base::client,
-				asio::bind_executor(sock->get_tls_strand(), [sock, state](const asio::error_code &ec) {
-					if (ec)
+				asio::bind_executor(sock->get_tls_strand(), [sock, state, started](const asio::error_code &ec) {
+					settle(ec);
+					if (ec) {
+						stats().tls_handshake_failures.add();
 						sock->reset_ssl();
+					}
+					else {
+						stats().tls_handshakes.add();
+						stats().tls_handshake_us.record(cs_impl::network::metrics::elapsed_us(started));
+					}
 					state->ec = ec;
 					sock->end_tls_handshake();
-					state->has_done.store(true, std::memory_order_release);
+					state->publish();
 				}));
 			}
 			catch (const std::exception &e) {
+				stats().async_pending.dec();
 				sock->reset_ssl();
 				sock->end_tls_handshake();
 				throw cs::lang_error(e.what());
@@ -957,7 +2350,7 @@ namespace network_cs_ext {
 			return state;
 		}
 
-		void read_until(tcp::socket_t &sock, state_t &state, const std::string &pattern)
+		void read_until_impl(tcp::socket_t &sock, state_t &state, const std::string &pattern, std::optional<std::chrono::milliseconds> timeout)
 		{
 			if (state->init && !state->has_done.load(std::memory_order_acquire))
 				throw cs::lang_error("Last asynchronous operation have not done yet.");
@@ -970,22 +2363,33 @@ namespace network_cs_ext {
 			state->is_read = true;
 			state->has_done = false;
 			state->ec.clear();
+			stats().async_pending.inc();
+			deadline_t deadline;
 			try {
-				auto on_done = [sock, state](const asio::error_code &ec, std::size_t bytes) {
+				deadline = make_deadline(sock, timeout);
+				auto on_done = [sock, state, deadline](asio::error_code ec, std::size_t bytes) {
 					// async_read_until already committed data to the streambuf
 					// internally; we must NOT call commit() again here.
+					settle_deadline(deadline, ec);
+					settle(ec);
+					stats().tcp_bytes_read.add(bytes);
 					state->bytes_transferred = bytes;
 					state->ec = ec;
 					sock->end_async_read();
-					state->has_done.store(true, std::memory_order_release);
+					state->publish();
 				};
-				if (sock->is_ssl())
+				if (deadline && sock->is_ssl())
+					asio::async_read_until(sock->get_tls_raw(), state->buffer, pattern, bind_deadline(deadline, on_done));
+				else if (deadline)
+					asio::async_read_until(sock->get_raw(), state->buffer, pattern, bind_deadline(deadline, on_done));
+				else if (sock->is_ssl())
 					asio::async_read_until(sock->get_tls_raw(), state->buffer, pattern,
 					                       asio::bind_executor(sock->get_tls_strand(), on_done));
 				else
 					asio::async_read_until(sock->get_raw(), state->buffer, pattern, on_done);
 			}
 			catch (...) {
+				stats().async_pending.dec();
 				sock->end_async_read();
 				state->init = previous_init;
 				state->is_read = previous_is_read;
@@ -993,64 +2397,119 @@ namespace network_cs_ext {
 				state->has_done.store(previous_has_done, std::memory_order_release);
 				throw;
 			}
+			arm_deadline(deadline, state);
 		}
 
-		state_t read(tcp::socket_t &sock, number requested_size)
+		void read_until(tcp::socket_t &sock, state_t &state, const std::string &pattern)
+		{
+			read_until_impl(sock, state, pattern, std::nullopt);
+		}
+
+		void read_until_for(tcp::socket_t &sock, state_t &state, const std::string &pattern, number timeout_ms)
+		{
+			read_until_impl(sock, state, pattern, checked_timeout(timeout_ms));
+		}
+
+		state_t read_impl(tcp::socket_t &sock, number requested_size, std::optional<std::chrono::milliseconds> timeout)
 		{
 			auto n = checked_io_buffer_size(requested_size);
 			state_t state = std::make_shared<state_type>();
 			state->init = true;
 			state->is_read = true;
 			begin_tcp_async_io([&sock] { sock->begin_async_read(); });
+			stats().async_pending.inc();
+			deadline_t deadline;
 			try {
-				auto on_done = [sock, state](const asio::error_code &ec, std::size_t bytes) {
+				deadline = make_deadline(sock, timeout);
+				auto on_done = [sock, state, deadline](asio::error_code ec, std::size_t bytes) {
+					settle_deadline(deadline, ec);
+					settle(ec);
+					stats().tcp_bytes_read.add(bytes);
 					state->buffer.commit(bytes);
 					state->bytes_transferred = bytes;
 					state->ec = ec;
 					sock->end_async_read();
-					state->has_done.store(true, std::memory_order_release);
+					state->publish();
 				};
-				if (sock->is_ssl())
+				if (deadline && sock->is_ssl())
+					asio::async_read(sock->get_tls_raw(), state->buffer.prepare(n), bind_deadline(deadline, on_done));
+				else if (deadline)
+					asio::async_read(sock->get_raw(), state->buffer.prepare(n), bind_deadline(deadline, on_done));
+				else if (sock->is_ssl())
 					asio::async_read(sock->get_tls_raw(), state->buffer.prepare(n),
 					                 asio::bind_executor(sock->get_tls_strand(), on_done));
 				else
 					asio::async_read(sock->get_raw(), state->buffer.prepare(n), on_done);
 			}
 			catch (...) {
+				stats().async_pending.dec();
 				sock->end_async_read();
 				throw;
 			}
+			arm_deadline(deadline, state);
 			return state;
 		}
 
-		state_t write(tcp::socket_t &sock, const std::string &data)
+		state_t read(tcp::socket_t &sock, number requested_size)
+		{
+			return read_impl(sock, requested_size, std::nullopt);
+		}
+
+		state_t read_for(tcp::socket_t &sock, number requested_size, number timeout_ms)
+		{
+			return read_impl(sock, requested_size, checked_timeout(timeout_ms));
+		}
+
+		state_t write_impl(tcp::socket_t &sock, const std::string &data, std::optional<std::chrono::milliseconds> timeout)
 		{
 			state_t state = std::make_shared<state_type>();
 			state->init = true;
 			begin_tcp_async_io([&sock] { sock->begin_async_write(); });
+			stats().async_pending.inc();
+			deadline_t deadline;
 			try {
+				deadline = make_deadline(sock, timeout);
 				std::ostream os(&state->buffer);
 				os.exceptions(std::ostream::badbit | std::ostream::failbit);
 				os.write(data.data(), data.size());
-				auto on_done = [sock, state](const asio::error_code &ec, std::size_t bytes) {
+				auto on_done = [sock, state, deadline](asio::error_code ec, std::size_t bytes) {
+					settle_deadline(deadline, ec);
+					settle(ec);
+					stats().tcp_bytes_written.add(bytes);
 					state->bytes_transferred = bytes;
 					state->ec = ec;
 					sock->end_async_write();
-					state->has_done.store(true, std::memory_order_release);
+					state->publish();
 				};
-				if (sock->is_ssl())
+				if (deadline && sock->is_ssl())
+					asio::async_write(sock->get_tls_raw(), state->buffer, bind_deadline(deadline, on_done));
+				else if (deadline)
+					asio::async_write(sock->get_raw(), state->buffer, bind_deadline(deadline, on_done));
+				else if (sock->is_ssl())
 					asio::async_write(sock->get_tls_raw(), state->buffer,
 					                  asio::bind_executor(sock->get_tls_strand(), on_done));
 				else
 					asio::async_write(sock->get_raw(), state->buffer, on_done);
 			}
 			catch (...) {
+				stats().async_pending.dec();
 				sock->end_async_write();
 				throw;
 			}
+			arm_deadline(deadline, state);
 			return state;
 		}
 
+		state_t write(tcp::socket_t &sock, const std::string &data)
+		{
+			return write_impl(sock, data, std::nullopt);
+		}
+
+		state_t write_for(tcp::socket_t &sock, const std::string &data, number timeout_ms)
+		{
+			return write_impl(sock, data, checked_timeout(timeout_ms));
+		}
+
 		state_t receive_from(udp::socket_t &sock, number requested_size)
 		{
 			auto n = checked_io_buffer_size(requested_size);
@@ -1059,23 +2518,127 @@ namespace network_cs_ext {
 			state->is_udp = true;
 			state->is_read = true;
 			begin_udp_async_io([&sock] { sock->begin_async_receive(); });
+			stats().async_pending.inc();
 			try {
 				sock->get_raw().async_receive_from(state->buffer.prepare(n), state->udp_endpoint,
 				[sock, state](const asio::error_code &ec, std::size_t bytes) {
+					settle(ec);
+					stats().udp_bytes_received.add(bytes);
 					state->buffer.commit(bytes);
 					state->bytes_transferred = bytes;
 					state->ec = ec;
 					sock->end_async_receive();
-					state->has_done.store(true, std::memory_order_release);
+					state->publish();
+				});
+			}
+			catch (...) {
+				stats().async_pending.dec();
+				sock->end_async_receive();
+				throw;
+			}
+			return state;
+		}
+
+		// Completes once the socket is readable, with every queued datagram
+		// up to max_count drained in one batch (possibly none)
+		state_t receive_batch(udp::socket_t &sock, number max_count, number max_size)
+		{
+			auto limits = udp::checked_batch_size(max_count, max_size);
+			state_t state = std::make_shared<state_type>();
+			state->init = true;
+			state->is_udp = true;
+			state->is_read = true;
+			state->is_batch = true;
+			begin_udp_async_io([&sock] { sock->begin_async_receive(); });
+			stats().async_pending.inc();
+			try {
+				sock->get_raw().async_wait(asio::socket_base::wait_read,
+				[sock, state, limits](asio::error_code ec) {
+					if (!ec) {
+						try {
+							sock->drain_batch(state->batch, limits.first, limits.second);
+						}
+						catch (const asio::system_error &e) {
+							ec = e.code();
+						}
+					}
+					settle(ec);
+					state->ec = ec;
+					sock->end_async_receive();
+					state->publish();
 				});
 			}
 			catch (...) {
+				stats().async_pending.dec();
 				sock->end_async_receive();
 				throw;
 			}
 			return state;
 		}
 
+		cs::var get_batch(const state_t &state)
+		{
+			if (!state->is_batch)
+				throw cs::lang_error("Asynchronous operation not a batch receive session.");
+			if (!state->has_done.load(std::memory_order_acquire))
+				return cs::null_pointer;
+			return udp::batch_to_array(state->batch);
+		}
+
+		/*
+		 * Completes at once from the resolve cache; otherwise asio's resolver
+		 * runs getaddrinfo on its own thread, so neither the calling thread
+		 * nor the fiber scheduler blocks on a slow DNS server.
+		 */
+		state_t resolve(const std::string &host, const std::string &service)
+		{
+			namespace dns = cs_impl::network::dns;
+			state_t state = std::make_shared<state_type>();
+			state->init = true;
+			state->is_resolve = true;
+			auto key = dns::resolve_cache::key('t', host, service);
+			dns::resolve_cache::entry hit;
+			if (dns::cache().lookup(key, hit)) {
+				for (auto &addr : hit.addresses)
+					state->endpoints.emplace_back(addr.first, addr.second);
+				state->ec = hit.ec;
+				state->publish();
+				return state;
+			}
+			auto resolver = std::make_shared<asio::ip::tcp::resolver>(cs_impl::network::get_io_context());
+			stats().async_pending.inc();
+			try {
+				resolver->async_resolve(host, service,
+				[resolver, state, key](const asio::error_code &ec, const asio::ip::tcp::resolver::results_type &results) {
+					settle(ec);
+					auto addresses = ec ? decltype(dns::addresses_of(results))() : dns::addresses_of(results);
+					dns::cache().store(key, addresses, ec);
+					for (auto &addr : addresses)
+						state->endpoints.emplace_back(addr.first, addr.second);
+					state->ec = ec;
+					state->publish();
+				});
+			}
+			catch (const std::exception &e) {
+				stats().async_pending.dec();
+				throw cs::lang_error(e.what());
+			}
+			return state;
+		}
+
+		cs::var get_endpoints(const state_t &state)
+		{
+			if (!state->is_resolve)
+				throw cs::lang_error("Asynchronous operation not a resolve session.");
+			if (!state->has_done.load(std::memory_order_acquire))
+				return cs::null_pointer;
+			cs::var ret = cs::var::make<cs::array>();
+			cs::array &arr = ret.val<cs::array>();
+			for (auto &ep : state->endpoints)
+				arr.push_back(cs::var::make<tcp::endpoint_t>(ep));
+			return ret;
+		}
+
 		state_t send_to(udp::socket_t &sock, const std::string &data, const udp::endpoint_t &ep)
 		{
 			state_t state = std::make_shared<state_type>();
@@ -1083,6 +2646,7 @@ namespace network_cs_ext {
 			state->is_udp = true;
 			state->udp_endpoint = ep;
 			begin_udp_async_io([&sock] { sock->begin_async_send(); });
+			stats().async_pending.inc();
 			// Pass streambuf data() directly as ConstBufferSequence to avoid
 			// truncation when the streambuf spans multiple internal blocks.
 			try {
@@ -1091,14 +2655,17 @@ namespace network_cs_ext {
 				os.write(data.data(), data.size());
 				sock->get_raw().async_send_to(state->buffer.data(), state->udp_endpoint,
 				[sock, state](const asio::error_code &ec, std::size_t bytes) {
+					settle(ec);
+					stats().udp_bytes_sent.add(bytes);
 					state->buffer.consume(bytes);
 					state->bytes_transferred = bytes;
 					state->ec = ec;
 					sock->end_async_send();
-					state->has_done.store(true, std::memory_order_release);
+					state->publish();
 				});
 			}
 			catch (...) {
+				stats().async_pending.dec();
 				sock->end_async_send();
 				throw;
 			}
@@ -1120,6 +2687,24 @@ namespace network_cs_ext {
 			return cs_impl::network::get_io_context().stopped();
 		}
 
+		// I/O backend compiled into ASIO (NETWORK_USE_IO_URING selects io_uring)
+		string backend()
+		{
+#if defined(ASIO_HAS_IO_URING_AS_DEFAULT)
+			return "io_uring";
+#elif defined(ASIO_HAS_IOCP)
+			return "iocp";
+#elif defined(ASIO_HAS_EPOLL)
+			return "epoll";
+#elif defined(ASIO_HAS_KQUEUE)
+			return "kqueue";
+#elif defined(ASIO_HAS_DEV_POLL)
+			return "dev_poll";
+#else
+			return "select";
+#endif
+		}
+
 		void restart()
 		{
 			auto &settings = get_global_settings();
@@ -1153,39 +2738,69 @@ namespace network_cs_ext {
 		.add_var("tcp", make_namespace(tcp::tcp_ext))
 		.add_var("udp", make_namespace(udp::udp_ext))
 		.add_var("host_name", make_cni(host_name))
+		.add_var("set_resolve_cache", make_cni(set_resolve_cache))
+		.add_var("clear_resolve_cache", make_cni(clear_resolve_cache))
 		.add_var("get_last_global_ssl_trust_report", make_cni(get_last_global_ssl_trust_report))
 		.add_var("to_fixed_hex", make_cni(to_fixed_hex))
 		.add_var("from_fixed_hex", make_cni(from_fixed_hex))
+		.add_var("http", make_namespace(http::http_ext))
+		.add_var("metrics", make_namespace(metrics::metrics_ext))
 		.add_var("async", make_namespace(async::async_ext));
 		(*async::state_ext)
 		.add_var("has_done", make_cni(async::has_done))
 		.add_var("get_result", make_cni(async::get_result))
+		.add_var("get_batch", make_cni(async::get_batch))
+		.add_var("get_endpoints", make_cni(async::get_endpoints))
+		.add_var("get_winner", make_cni(async::get_winner))
+		.add_var("get_sockets", make_cni(async::get_sockets))
 		.add_var("get_buffer", make_cni(async::get_buffer))
 		.add_var("eof", make_cni(async::eof))
+		.add_var("timed_out", make_cni(async::timed_out))
 		.add_var("available", make_cni(async::available))
 		.add_var("get_error", make_cni(async::get_error))
 		.add_var("get_endpoint", make_cni(async::get_endpoint))
 		.add_var("wait", make_cni(async::wait))
 		.add_var("wait_for", make_cni(async::wait_for));
+		(*async::ready_queue_ext)
+		.add_var("watch", make_cni(async::rq::watch))
+		.add_var("push", make_cni(async::rq::push))
+		.add_var("pop", make_cni(async::rq::pop))
+		.add_var("size", make_cni(async::rq::size))
+		.add_var("empty", make_cni(async::rq::empty));
 		(*async::async_ext)
 		.add_var("state", var::make_constant<type_t>(async::create_async_state, type_id(typeid(async::state_t)), async::state_ext))
+		.add_var("ready_queue", var::make_constant<type_t>(async::create_ready_queue, type_id(typeid(async::ready_queue_t)), async::ready_queue_ext))
 		.add_var("accept", make_cni(async::accept))
 		.add_var("connect", make_cni(async::connect))
 		.add_var("connect_ssl", make_cni(async::connect_ssl))
 		.add_var("read_until", make_cni(async::read_until))
 		.add_var("read", make_cni(async::read))
 		.add_var("write", make_cni(async::write))
+		.add_var("accept_for", make_cni(async::accept_for))
+		.add_var("accept_batch", make_cni(async::accept_batch))
+		.add_var("connect_for", make_cni(async::connect_for))
+		.add_var("connect_any", make_cni(async::connect_any))
+		.add_var("connect_any_for", make_cni(async::connect_any_for))
+		.add_var("read_until_for", make_cni(async::read_until_for))
+		.add_var("read_for", make_cni(async::read_for))
+		.add_var("write_for", make_cni(async::write_for))
 		.add_var("receive_from", make_cni(async::receive_from))
+		.add_var("receive_batch", make_cni(async::receive_batch))
+		.add_var("resolve", make_cni(async::resolve))
 		.add_var("send_to", make_cni(async::send_to))
 		.add_var("poll", make_cni(async::poll))
 		.add_var("poll_once", make_cni(async::poll_once))
 		.add_var("stopped", make_cni(async::stopped))
+		.add_var("backend", make_cni(async::backend))
 		.add_var("restart", make_cni(async::restart))
 		.add_var("work_guard", var::make_constant<type_t>(async::work_guard, type_id(typeid(async::work_guard_t))))
 		.add_var("thread_worker", var::make_constant<type_t>(async::thread_worker, type_id(typeid(async::thread_executor_t))));
 		(*tcp::tcp_ext)
 		.add_var("socket", var::make_constant<type_t>(tcp::socket::socket, type_id(typeid(tcp::socket_t)), tcp::socket::socket_ext))
 		.add_var("acceptor", make_cni(tcp::acceptor, true))
+		.add_var("acceptor_from_handle", make_cni(tcp::acceptor_from_handle, true))
+		.add_var("acceptor_with_backlog", make_cni(tcp::acceptor_with_backlog, true))
+		.add_var("listen_stats", make_cni(tcp::listen_stats))
 		.add_var("endpoint", make_cni(tcp::endpoint, true))
 		.add_var("endpoint_v4", make_cni(tcp::endpoint_v4, true))
 		.add_var("endpoint_v6", make_cni(tcp::endpoint_v6, true))
@@ -1202,8 +2817,20 @@ namespace network_cs_ext {
 		.add_var("set_opt_reuse_address", make_cni(tcp::socket::set_opt_reuse_address))
 		.add_var("set_opt_no_delay", make_cni(tcp::socket::set_opt_no_delay))
 		.add_var("set_opt_keep_alive", make_cni(tcp::socket::set_opt_keep_alive))
+		.add_var("set_opt_keep_alive_params", make_cni(tcp::socket::set_opt_keep_alive_params))
+		.add_var("set_opt_quick_ack", make_cni(tcp::socket::set_opt_quick_ack))
+		.add_var("set_opt_cork", make_cni(tcp::socket::set_opt_cork))
+		.add_var("set_opt_notsent_lowat", make_cni(tcp::socket::set_opt_notsent_lowat))
+		.add_var("set_opt_user_timeout", make_cni(tcp::socket::set_opt_user_timeout))
+		.add_var("set_opt_busy_poll", make_cni(tcp::socket::set_opt_busy_poll))
+		.add_var("set_opt_fast_open_connect", make_cni(tcp::socket::set_opt_fast_open_connect))
+		.add_var("set_opt_linger", make_cni(tcp::socket::set_opt_linger))
+		.add_var("set_opt_receive_buffer", make_cni(tcp::socket::set_opt_receive_buffer))
+		.add_var("set_opt_send_buffer", make_cni(tcp::socket::set_opt_send_buffer))
+		.add_var("tcp_info", make_cni(tcp::socket::tcp_info))
 		.add_var("available", make_cni(tcp::socket::available))
 		.add_var("peer_closed", make_cni(tcp::socket::peer_closed))
+		.add_var("async_jobs", make_cni(tcp::socket::async_jobs))
 		.add_var("receive", make_cni(tcp::socket::receive))
 		.add_var("read", make_cni(tcp::socket::read))
 		.add_var("send", make_cni(tcp::socket::send))
@@ -1217,13 +2844,29 @@ namespace network_cs_ext {
 		.add_var("is_v4", make_cni(tcp::ep::is_v4, true))
 		.add_var("is_v6", make_cni(tcp::ep::is_v6, true))
 		.add_var("port", make_cni(tcp::ep::port, true));
+		(*tcp::acpt::acceptor_ext)
+		.add_var("native_handle", make_cni(tcp::acpt::native_handle))
+		.add_var("set_inheritable", make_cni(tcp::acpt::set_inheritable))
+		.add_var("set_opt_fast_open", make_cni(tcp::acpt::set_opt_fast_open))
+		.add_var("set_opt_defer_accept", make_cni(tcp::acpt::set_opt_defer_accept))
+		.add_var("queue_stats", make_cni(tcp::acpt::queue_stats))
+		.add_var("local_endpoint", make_cni(tcp::acpt::local_endpoint))
+		.add_var("close", make_cni(tcp::acpt::close));
 		(*udp::udp_ext)
 		.add_var("socket", var::make_constant<type_t>(udp::socket::socket, type_id(typeid(udp::socket_t)), udp::socket::socket_ext))
 		.add_var("endpoint", make_cni(udp::endpoint, true))
 		.add_var("endpoint_v4", make_cni(udp::endpoint_v4, true))
 		.add_var("endpoint_broadcast", make_cni(udp::endpoint_broadcast, true))
 		.add_var("endpoint_v6", make_cni(udp::endpoint_v6, true))
-		.add_var("resolve", make_cni(udp::resolve, true));
+		.add_var("resolve", make_cni(udp::resolve, true))
+		.add_var("multi_receiver", make_cni(udp::multi_receiver));
+		(*udp::mr::multi_receiver_ext)
+		.add_var("receive", make_cni(udp::mr::receive))
+		.add_var("wait_for", make_cni(udp::mr::wait_for))
+		.add_var("stop", make_cni(udp::mr::stop))
+		.add_var("size", make_cni(udp::mr::size))
+		.add_var("overflow", make_cni(udp::mr::overflow))
+		.add_var("error", make_cni(udp::mr::error));
 		(*udp::socket::socket_ext)
 		.add_var("open_v4", make_cni(udp::socket::open_v4))
 		.add_var("open_v6", make_cni(udp::socket::open_v6))
@@ -1237,6 +2880,20 @@ namespace network_cs_ext {
 		.add_var("available", make_cni(udp::socket::available))
 		.add_var("receive_from", make_cni(udp::socket::receive_from))
 		.add_var("send_to", make_cni(udp::socket::send_to))
+		.add_var("receive_batch", make_cni(udp::socket::receive_batch))
+		.add_var("send_batch", make_cni(udp::socket::send_batch))
+		.add_var("send_segmented", make_cni(udp::socket::send_segmented))
+		.add_var("set_opt_gro", make_cni(udp::socket::set_opt_gro))
+		.add_var("join_group", make_cni(udp::socket::join_group))
+		.add_var("leave_group", make_cni(udp::socket::leave_group))
+		.add_var("set_opt_multicast_interface", make_cni(udp::socket::set_opt_multicast_interface))
+		.add_var("set_opt_multicast_ttl", make_cni(udp::socket::set_opt_multicast_ttl))
+		.add_var("set_opt_multicast_loop", make_cni(udp::socket::set_opt_multicast_loop))
+		.add_var("set_opt_receive_buffer", make_cni(udp::socket::set_opt_receive_buffer))
+		.add_var("set_opt_send_buffer", make_cni(udp::socket::set_opt_send_buffer))
+		.add_var("set_opt_rxq_ovfl", make_cni(udp::socket::set_opt_rxq_ovfl))
+		.add_var("dropped", make_cni(udp::socket::dropped))
+		.add_var("gso_available", make_cni(udp::socket::gso_available))
 		.add_var("local_endpoint", make_cni(udp::socket::local_endpoint))
 		.add_var("remote_endpoint", make_cni(udp::socket::remote_endpoint));
 		(*udp::ep::ep_ext)
@@ -1244,6 +2901,40 @@ namespace network_cs_ext {
 		.add_var("is_v4", make_cni(udp::ep::is_v4, true))
 		.add_var("is_v6", make_cni(udp::ep::is_v6, true))
 		.add_var("port", make_cni(udp::ep::port, true));
+		(*metrics::metrics_ext)
+		.add_var("counter_add", make_cni(metrics::counter_add))
+		.add_var("gauge_set", make_cni(metrics::gauge_set))
+		.add_var("gauge_add", make_cni(metrics::gauge_add))
+		.add_var("observe", make_cni(metrics::observe))
+		.add_var("describe", make_cni(metrics::describe))
+		.add_var("snapshot", make_cni(metrics::snapshot))
+		.add_var("prometheus", make_cni(metrics::prometheus))
+		.add_var("now_us", make_cni(metrics::now_us));
+		(*http::http_ext)
+		.add_var("router", var::make_constant<type_t>(http::router, type_id(typeid(http::router_t)), http::rt::router_ext))
+		.add_var("access_log", make_cni(http::access_log))
+		.add_var("rate_limiter", make_cni(http::rate_limiter))
+		.add_var("date", make_cni(http::date))
+		.add_var("file_size", make_cni(http::file_size));
+		(*http::rt::router_ext)
+		.add_var("add", make_cni(http::rt::add))
+		.add_var("match", make_cni(http::rt::match))
+		.add_var("allowed", make_cni(http::rt::allowed))
+		.add_var("size", make_cni(http::rt::size));
+		(*http::alog::access_log_ext)
+		.add_var("set_format", make_cni(http::alog::set_format))
+		.add_var("set_overflow", make_cni(http::alog::set_overflow))
+		.add_var("write", make_cni(http::alog::write))
+		.add_var("access", make_cni(http::alog::access))
+		.add_var("flush", make_cni(http::alog::flush))
+		.add_var("dropped", make_cni(http::alog::dropped))
+		.add_var("close", make_cni(http::alog::close));
+		(*http::rl::rate_limiter_ext)
+		.add_var("acquire", make_cni(http::rl::acquire))
+		.add_var("acquire_n", make_cni(http::rl::acquire_n))
+		.add_var("acquire_peer", make_cni(http::rl::acquire_peer))
+		.add_var("size", make_cni(http::rl::size))
+		.add_var("clear", make_cni(http::rl::clear));
 	}
 }
 
@@ -1406,6 +3097,33 @@ bool network_cs_ext::udp::socket::safe_close(socket_t &sock)
 	}
 }
 
+// Queue non-empty within timeout_ms
+bool network_cs_ext::udp::mr::wait_for(multi_receiver_t &r, number timeout_ms)
+{
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(static_cast<long long>(timeout_ms < 0 ? 0 : timeout_ms));
+	while (r->impl->size() == 0) {
+		if (std::chrono::steady_clock::now() >= deadline || r->impl->finished_receiving())
+			return r->impl->size() > 0;
+		network_cs_ext::async::get_global_settings().poll();
+		cs_runtime_yield();
+	}
+	return true;
+}
+// Cancel the receives and wait until the socket's receive slot is released;
+// queued datagrams stay readable
+bool network_cs_ext::udp::mr::stop(multi_receiver_t &r)
+{
+	r->impl->stop();
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(NETWORK_SAFE_SHUTDOWN_TIMEOUT_MS);
+	while (!r->impl->finished_receiving()) {
+		if (std::chrono::steady_clock::now() >= deadline)
+			return false;
+		network_cs_ext::async::get_global_settings().poll();
+		cs_runtime_yield();
+	}
+	return true;
+}
+
 namespace cs_impl {
 	template <>
 	cs::namespace_t &get_ext<network_cs_ext::tcp::socket_t>()
@@ -1413,6 +3131,12 @@ namespace cs_impl {
 		return network_cs_ext::tcp::socket::socket_ext;
 	}
 
+	template <>
+	cs::namespace_t &get_ext<network_cs_ext::tcp::acceptor_t>()
+	{
+		return network_cs_ext::tcp::acpt::acceptor_ext;
+	}
+
 	template <>
 	cs::namespace_t &get_ext<network_cs_ext::tcp::endpoint_t>()
 	{
@@ -1431,12 +3155,42 @@ namespace cs_impl {
 		return network_cs_ext::udp::ep::ep_ext;
 	}
 
+	template <>
+	cs::namespace_t &get_ext<network_cs_ext::udp::multi_receiver_t>()
+	{
+		return network_cs_ext::udp::mr::multi_receiver_ext;
+	}
+
 	template <>
 	cs::namespace_t &get_ext<network_cs_ext::async::state_t>()
 	{
 		return network_cs_ext::async::state_ext;
 	}
 
+	template <>
+	cs::namespace_t &get_ext<network_cs_ext::async::ready_queue_t>()
+	{
+		return network_cs_ext::async::ready_queue_ext;
+	}
+
+	template <>
+	cs::namespace_t &get_ext<network_cs_ext::http::router_t>()
+	{
+		return network_cs_ext::http::rt::router_ext;
+	}
+
+	template <>
+	cs::namespace_t &get_ext<network_cs_ext::http::access_log_t>()
+	{
+		return network_cs_ext::http::alog::access_log_ext;
+	}
+
+	template <>
+	cs::namespace_t &get_ext<network_cs_ext::http::rate_limiter_t>()
+	{
+		return network_cs_ext::http::rl::rate_limiter_ext;
+	}
+
 	template <>
 	constexpr const char *get_name_of_type<network_cs_ext::tcp::socket_t>()
 	{
@@ -1461,6 +3215,12 @@ namespace cs_impl {
 		return "cs::network::udp::socket";
 	}
 
+	template <>
+	constexpr const char *get_name_of_type<network_cs_ext::udp::multi_receiver_t>()
+	{
+		return "cs::network::udp::multi_receiver";
+	}
+
 	template <>
 	constexpr const char *get_name_of_type<network_cs_ext::udp::endpoint_t>()
 	{
@@ -1473,6 +3233,30 @@ namespace cs_impl {
 		return "cs::network::async::state";
 	}
 
+	template <>
+	constexpr const char *get_name_of_type<network_cs_ext::async::ready_queue_t>()
+	{
+		return "cs::network::async::ready_queue";
+	}
+
+	template <>
+	constexpr const char *get_name_of_type<network_cs_ext::http::router_t>()
+	{
+		return "cs::network::http::router";
+	}
+
+	template <>
+	constexpr const char *get_name_of_type<network_cs_ext::http::access_log_t>()
+	{
+		return "cs::network::http::access_log";
+	}
+
+	template <>
+	constexpr const char *get_name_of_type<network_cs_ext::http::rate_limiter_t>()
+	{
+		return "cs::network::http::rate_limiter";
+	}
+
 	template <>
 	constexpr const char *get_name_of_type<network_cs_ext::async::work_guard_t>()
 	{
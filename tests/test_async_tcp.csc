@@ -1,3 +1,4 @@
+import network
 import network.tcp as tcp
 import network.async as async
 
@@ -551,6 +552,253 @@ catch e
 end
 check("T63: negative get_buffer size rejected", negative_get_buffer_rejected)
 
+section("per-operation deadlines")
+
+var port8 = 0
+var acceptor8 = null
+test_port = 12700
+while test_port < 12800
+    try
+        acceptor8 = tcp.acceptor(tcp.endpoint_v4(test_port))
+        port8 = test_port
+        break
+    catch e
+        test_port += 1
+    end
+end
+
+check("T64: deadline test found free port", port8 != 0)
+if port8 != 0
+    guard = new async.work_guard
+    var idle8 = new tcp.socket
+    var idle_accept8 = async.accept_for(idle8, acceptor8, 50)
+    check("T65: accept_for expires", !idle_accept8.wait() && idle_accept8.timed_out())
+
+    var server8 = new tcp.socket
+    var accept_state8 = async.accept_for(server8, acceptor8, 5000)
+    var client8 = new tcp.socket
+    var connect_state8 = async.connect_for(client8, tcp.endpoint("127.0.0.1", port8), 5000)
+    check("T66: connect_for completes", connect_state8.wait() && !connect_state8.timed_out())
+    check("T67: accept_for completes", accept_state8.wait())
+
+    var read_start8 = runtime.time()
+    var expired_read8 = async.read_for(server8, 4, 100)
+    var write_during_read8 = async.write_for(server8, "pong", 5000)
+    check("T68: write_for overlaps a read_for", write_during_read8.wait())
+    check("T69: read_for expires", !expired_read8.wait() && expired_read8.timed_out())
+    check("T70: read_for cancelled near its deadline", runtime.time() - read_start8 < 2000)
+    check_eq("T71: peer received write", client8.read(4), "pong")
+
+    var line_state8 = new async.state
+    async.read_until_for(server8, line_state8, "\n", 5000)
+    client8.write("hello\n")
+    check("T72: read_until_for completes before deadline", line_state8.wait() && !line_state8.timed_out())
+    check_eq("T73: read_until_for result", line_state8.get_result(), "hello\n")
+
+    var negative_deadline_rejected = false
+    try
+        async.read_for(server8, 1, -1)
+    catch e
+        negative_deadline_rejected = true
+    end
+    check("T74: negative deadline rejected", negative_deadline_rejected)
+
+    client8.close()
+    server8.close()
+end
+
+section("async resolve and resolve cache")
+
+guard = new async.work_guard
+network.clear_resolve_cache()
+var resolve_state = async.resolve("127.0.0.1", "8080")
+check("T75: async resolve completes", wait_for(resolve_state, 5000) && resolve_state.get_error() == null)
+var resolved = resolve_state.get_endpoints()
+check("T76: async resolve returns endpoints", resolved != null && !resolved.empty())
+if resolved != null && !resolved.empty()
+    check_eq("T77: resolved port", resolved.front.port(), 8080)
+end
+var cached_state = async.resolve("127.0.0.1", "8080")
+check("T78: cached resolve completes at once", cached_state.has_done())
+check_eq("T79: sync resolve shares the cache", tcp.resolve("127.0.0.1", "8080").size, resolved.size)
+
+var non_resolve_state = new async.state
+var non_resolve_rejected = false
+try
+    non_resolve_state.get_endpoints()
+catch e
+    non_resolve_rejected = true
+end
+check("T80: get_endpoints rejects other sessions", non_resolve_rejected)
+
+var negative_cache_rejected = false
+try
+    network.set_resolve_cache(-1, 0, 0)
+catch e
+    negative_cache_rejected = true
+end
+check("T81: negative cache settings rejected", negative_cache_rejected)
+
+section("async connect_any")
+
+if port8 != 0
+    guard = new async.work_guard
+    var server9 = new tcp.socket
+    var accept_state9 = async.accept_for(server9, acceptor8, 5000)
+    var client9 = new tcp.socket
+    # A refused endpoint first: the race must fail over to the live one
+    var candidates9 = {tcp.endpoint("127.0.0.1", 1), tcp.endpoint("127.0.0.1", port8)}
+    var race_start9 = runtime.time()
+    var race9 = async.connect_any(client9, candidates9, 2000)
+    check("T82: connect_any completes", wait_for(race9, 5000) && race9.get_error() == null)
+    check("T83: failed attempt skips the stagger delay", runtime.time() - race_start9 < 2000)
+    check_eq("T84: winner is the live endpoint", race9.get_winner().port(), port8)
+    check("T85: winner accepted", accept_state9.wait())
+    client9.write("ping")
+    check_eq("T86: winning socket is usable", server9.read(4), "ping")
+    client9.close()
+    server9.close()
+
+    var refused9 = async.connect_any_for(new tcp.socket, {tcp.endpoint("127.0.0.1", 1)}, 0, 5000)
+    check("T87: connect_any fails when every attempt fails", !refused9.wait() && !refused9.timed_out())
+
+    var empty_rejected9 = false
+    try
+        async.connect_any(new tcp.socket, {}, 250)
+    catch e
+        empty_rejected9 = true
+    end
+    check("T88: empty endpoint list rejected", empty_rejected9)
+end
+
+section("async accept_batch")
+
+var acceptor10 = null
+var port10 = 0
+test_port = 12900
+while test_port < 13000
+    try
+        acceptor10 = tcp.acceptor_with_backlog(tcp.endpoint_v4(test_port), 16)
+        port10 = test_port
+        break
+    catch e
+        test_port += 1
+    end
+end
+
+check("T89: backlog acceptor found free port", port10 != 0)
+if port10 != 0
+    guard = new async.work_guard
+    # Three connections complete the handshake before anyone accepts
+    var clients10 = new array
+    foreach i in range(3)
+        var c = new tcp.socket
+        c.connect(tcp.endpoint("127.0.0.1", port10))
+        clients10.push_back(c)
+    end
+    if system.is_platform_linux()
+        var queue10 = acceptor10.queue_stats()
+        check("T90: queue_stats reports queued connections", queue10["queued"] > 0)
+        check_eq("T91: queue_stats reports the backlog", queue10["backlog"], 16)
+        var listen10 = tcp.listen_stats()
+        check("T92: listen_stats reports overflows", listen10.exist("overflows") && listen10["overflows"] >= 0)
+    end
+    var batch10 = async.accept_batch(acceptor10, 2)
+    check("T93: queued connections accepted at once", batch10.has_done() && batch10.get_error() == null)
+    check_eq("T94: batch bounded by max_count", batch10.get_sockets().size, 2)
+    var rest10 = async.accept_batch(acceptor10, 64)
+    check("T95: second batch completes", wait_for(rest10, 5000))
+    var rest_socks10 = rest10.get_sockets()
+    check_eq("T96: second batch drains the queue", rest_socks10.size, 1)
+
+    var waiting10 = async.accept_batch(acceptor10, 64)
+    check("T97: empty queue waits", !waiting10.has_done())
+    var late10 = new tcp.socket
+    late10.connect(tcp.endpoint("127.0.0.1", port10))
+    check("T98: batch wakes on a new connection", wait_for(waiting10, 5000))
+    var late_socks10 = waiting10.get_sockets()
+    check_eq("T99: woken batch has the connection", late_socks10.size, 1)
+    late10.write("ping")
+    check_eq("T100: accepted socket is usable", late_socks10[0].read(4), "ping")
+
+    var bad_batch_rejected = false
+    try
+        async.accept_batch(acceptor10, 0)
+    catch e
+        bad_batch_rejected = true
+    end
+    check("T101: invalid batch size rejected", bad_batch_rejected)
+
+    var closing10 = async.accept_batch(acceptor10, 8)
+    acceptor10.close()
+    check("T102: closing the listener ends a waiting batch", wait_for(closing10, 5000))
+    check("T103: closed listener batch reports an error", closing10.get_error() != null)
+end
+
+section("async ready_queue")
+
+var acceptor11 = null
+var port11 = 0
+test_port = 13000
+while test_port < 13100
+    try
+        acceptor11 = tcp.acceptor(tcp.endpoint_v4(test_port))
+        port11 = test_port
+        break
+    catch e
+        test_port += 1
+    end
+end
+
+check("T104: ready_queue acceptor found free port", port11 != 0)
+if port11 != 0
+    guard = new async.work_guard
+    var clients11 = new array
+    foreach i in range(2)
+        var c = new tcp.socket
+        c.connect(tcp.endpoint("127.0.0.1", port11))
+        clients11.push_back(c)
+    end
+    var batch11 = async.accept_batch(acceptor11, 2)
+    check("T105: connections accepted", wait_for(batch11, 5000))
+    var socks11 = batch11.get_sockets()
+    var ready11 = new async.ready_queue
+    var states11 = new array
+    foreach i in range(socks11.size)
+        var st = new async.state
+        async.read_until_for(socks11[i], st, "\r\n", 5000)
+        ready11.watch(st, i)
+        states11.push_back(st)
+    end
+    foreach i in range(10) do async.poll()
+    check("T106: idle reads queue nothing", ready11.empty() && ready11.pop() == null)
+
+    clients11[1].write("hello\r\n")
+    var start11 = runtime.time()
+    while ready11.empty() && runtime.time() - start11 < 5000
+        async.poll_once()
+        runtime.delay(10)
+    end
+    check_eq("T107: completed read queued once", ready11.size(), 1)
+    check_eq("T108: queued id names the connection", ready11.pop(), 1)
+    check_eq("T109: watched state holds the line", states11[1].get_result(), "hello\r\n")
+
+    ready11.watch(states11[1], 7)
+    check_eq("T110: watching a completed state queues at once", ready11.pop(), 7)
+
+    clients11[0].close()
+    start11 = runtime.time()
+    while ready11.empty() && runtime.time() - start11 < 5000
+        async.poll_once()
+        runtime.delay(10)
+    end
+    check_eq("T111: closed peer queued", ready11.pop(), 0)
+    check("T112: closed peer read reports eof", states11[0].eof())
+    ready11.push(3)
+    check_eq("T113: pushed id queued", ready11.pop(), 3)
+    clients11[1].close()
+end
+
 system.out.println("")
 system.out.println("=== Results ===")
 system.out.println("PASS: " + _pass)
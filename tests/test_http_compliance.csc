@@ -825,6 +825,66 @@ c.write("FOO /methods HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n")
 r = read_http_response(c, srv, 5000)
 check_contains("C13-06: unknown method still 200 OK", r, "200 OK")
 c.close()
+drive_n(srv, 5)
+
+# HEAD body is suppressed even though the handler produced one
+srv.bind_route("GET", "/get-only", echo_handler)
+c = new tcp.socket
+c.connect(tcp.endpoint("127.0.0.1", p))
+c.write(http_req("HEAD", "/get-only", "127.0.0.1:" + to_string(p), {"Connection: close"}, null))
+r = read_http_response(c, srv, 5000)
+check_contains("C13-07: HEAD served by GET route", r, "200 OK")
+check_not_contains("C13-08: HEAD response has no body", r, "method=")
+c.close()
+drive_n(srv, 5)
+
+# OPTIONS and 405 list the bound methods
+c = new tcp.socket
+c.connect(tcp.endpoint("127.0.0.1", p))
+c.write(http_req("OPTIONS", "/get-only", "127.0.0.1:" + to_string(p), {"Connection: close"}, null))
+r = read_http_response(c, srv, 5000)
+check_contains("C13-09: OPTIONS 204", r, "204 No Content")
+check_contains("C13-10: OPTIONS Allow header", r, "Allow: GET, HEAD, OPTIONS")
+c.close()
+drive_n(srv, 5)
+
+reset_state()
+c = new tcp.socket
+c.connect(tcp.endpoint("127.0.0.1", p))
+c.write(http_req("POST", "/get-only", "127.0.0.1:" + to_string(p), {"Connection: close"}, "x"))
+r = read_http_response(c, srv, 5000)
+check_contains("C13-11: POST to GET route is 405", r, "405 Method Not Allowed")
+check_contains("C13-12: 405 Allow header", r, "Allow: GET, HEAD, OPTIONS")
+check_eq("C13-13: handler not called", g_count, 0)
+c.close()
+drive_n(srv, 5)
+
+# HEAD on a bind_page route answers from the file size
+var page_path = "build/c13_page.html"
+var page_file = iostream.fstream(page_path, iostream.openmode.out)
+page_file.print("<html>page</html>")
+page_file.close()
+srv.bind_page("/page", page_path)
+c = new tcp.socket
+c.connect(tcp.endpoint("127.0.0.1", p))
+c.write(http_req("HEAD", "/page", "127.0.0.1:" + to_string(p), {"Connection: close"}, null))
+r = read_http_response(c, srv, 5000)
+check_contains("C13-14: HEAD on bind_page 200 OK", r, "200 OK")
+check_contains("C13-15: HEAD on bind_page has file size", r, "Content-Length: 17")
+check_not_contains("C13-16: HEAD on bind_page has no body", r, "<html>")
+c.close()
+drive_n(srv, 5)
+
+# OPTIONS on a bind_page route is answered, not served as GET
+c = new tcp.socket
+c.connect(tcp.endpoint("127.0.0.1", p))
+c.write(http_req("OPTIONS", "/page", "127.0.0.1:" + to_string(p), {"Connection: close"}, null))
+r = read_http_response(c, srv, 5000)
+check_contains("C13-17: OPTIONS on bind_page 204", r, "204 No Content")
+check_contains("C13-18: OPTIONS on bind_page Allow header", r, "Allow: GET, HEAD, OPTIONS")
+check_not_contains("C13-19: OPTIONS on bind_page has no body", r, "<html>")
+c.close()
+system.file.remove(page_path)
 
 srv.acceptor = null
 srv = null
@@ -1,6 +1,9 @@
 import netutils
 import network.tcp as tcp
 import network.async as async
+import network.metrics as metrics
+import network.http as http
+import process
 
 var _pass = 0
 var _fail = 0
@@ -304,6 +307,529 @@ else
     srv7 = null
 end
 
+# ============================================================
+# S08 -- Radix-tree router
+# ============================================================
+section("S08: radix-tree router")
+
+function noop_handler(srv, session)
+end
+
+var srv8 = new netutils.http_server
+srv8.bind_func("/api", noop_handler)
+srv8.bind_func("/static/", noop_handler)
+srv8.bind_route("GET", "/user/:id", noop_handler)
+srv8.bind_route("POST", "/user/:id", noop_handler)
+srv8.bind_func("/user/me", noop_handler)
+srv8.bind_func("/user/:id/posts/:pid", noop_handler)
+srv8.bind_func("/files/*path", noop_handler)
+srv8.bind_func("404 Not Found", noop_handler)
+check_eq("S08-01: routes registered", srv8.router.size(), 7)
+
+var r8 = srv8.router.match("GET", "/api")
+check("S08-02: exact match", r8 != null && r8["route"] == "/api" && r8["exact"])
+r8 = srv8.router.match("GET", "/api/v1/items")
+check("S08-03: prefix match", r8 != null && r8["route"] == "/api" && !r8["exact"])
+check("S08-04: prefix stops at component boundary", srv8.router.match("GET", "/api-v2") == null)
+r8 = srv8.router.match("GET", "/static/css/site.css")
+check("S08-05: trailing slash prefix", r8 != null && r8["route"] == "/static/")
+r8 = srv8.router.match("GET", "/user/42")
+check("S08-06: method route with parameter", r8 != null && r8["route"] == "GET /user/:id" && r8["params"]["id"] == "42")
+r8 = srv8.router.match("POST", "/user/42")
+check("S08-07: routes are method specific", r8 != null && r8["route"] == "POST /user/:id")
+check("S08-08: unbound method misses", srv8.router.match("DELETE", "/user/42") == null)
+r8 = srv8.router.match("DELETE", "/user/me")
+check("S08-09: static segment wins over parameter", r8 != null && r8["route"] == "/user/me")
+r8 = srv8.router.match("GET", "/user/7/posts/9")
+check("S08-10: several parameters", r8 != null && r8["params"]["id"] == "7" && r8["params"]["pid"] == "9")
+r8 = srv8.router.match("GET", "/files/a/b.txt")
+check("S08-11: wildcard captures the rest", r8 != null && r8["route"] == "/files/*path" && r8["params"]["path"] == "a/b.txt")
+check("S08-12: status handler stays in url_map", srv8.url_map.exist("404 Not Found"))
+var bad8 = false
+try
+    srv8.bind_func("/files/*path/more", noop_handler)
+catch e
+    bad8 = true
+end
+check("S08-13: wildcard must be last", bad8)
+srv8 = null
+
+# ============================================================
+# S09 -- Access log written by the background writer
+# ============================================================
+section("S09: access log")
+
+var srv9_port = find_free_port()
+var log9_path = "test_access_" + to_string(srv9_port) + ".log"
+if srv9_port == 0
+    check("S09-00: find free port", false)
+else
+    var srv9 = new netutils.http_server
+    srv9.set_config({"thread_count": 1, "worker_count": 1, "access_log_format": "json", "access_log_flush": 10, "access_log": log9_path}.to_hash_map())
+    check("S09-01: access log opened", srv9.access_log != null)
+    srv9.bind_func("/logged", [](srv, session){
+        session.send_response("200 OK", "logged", "text/plain")
+    })
+    srv9.listen(srv9_port)
+    var i9 = 0
+    while i9 < 10
+        srv9.poll()
+        async.poll_once()
+        i9 += 1
+    end
+
+    var client9 = new tcp.socket
+    client9.connect(tcp.endpoint("127.0.0.1", srv9_port))
+    client9.write("GET /logged?x=1 HTTP/1.1\r\nHost: 127.0.0.1\r\nUser-Agent: s09\r\nConnection: close\r\n\r\n")
+    var start9 = runtime.time()
+    while client9.available() == 0 && runtime.time() - start9 < 5000
+        srv9.poll()
+        async.poll_once()
+        runtime.delay(5)
+    end
+    # Let the worker finish the response and queue the entry
+    i9 = 0
+    while i9 < 10
+        srv9.poll()
+        async.poll_once()
+        i9 += 1
+    end
+    client9.close()
+    srv9.access_log.flush()
+    check_eq("S09-02: nothing dropped", srv9.access_log.dropped(), 0)
+    var log9_handle = srv9.access_log
+    srv9.stop()
+    check("S09-03: stop() detaches the access log", srv9.access_log == null)
+    # A closed log refuses entries, even with the block policy
+    log9_handle.set_overflow("block")
+    check("S09-04: write after close refused", !log9_handle.write("late"))
+    log9_handle.flush()
+    check_eq("S09-05: refused entry not counted as dropped", log9_handle.dropped(), 0)
+
+    var log9 = netutils.read_file(log9_path)
+    check("S09-06: request line logged", log9.find("\"method\":\"GET\",\"target\":\"/logged?x=1\"", 0) != -1)
+    check("S09-07: status logged", log9.find("\"status\":200", 0) != -1)
+    check("S09-08: user agent logged", log9.find("\"user_agent\":\"s09\"", 0) != -1)
+    system.file.remove(log9_path)
+    srv9 = null
+end
+
+# ============================================================
+# S10 -- Metrics registry and Prometheus endpoint
+# ============================================================
+section("S10: metrics")
+
+metrics.counter_add("s10_events_total", 2)
+metrics.counter_add("s10_events_total", 3)
+metrics.gauge_set("s10_level", 7)
+metrics.gauge_add("s10_level", -2)
+metrics.observe("s10_latency", 100)
+metrics.observe("s10_latency", 300)
+var snap10 = metrics.snapshot()
+check_eq("S10-01: counter accumulates", snap10["s10_events_total"], 5)
+check_eq("S10-02: gauge set and add", snap10["s10_level"], 5)
+check_eq("S10-03: histogram count", snap10["s10_latency"]["count"], 2)
+check("S10-04: histogram percentile", snap10["s10_latency"]["p50"] >= 100 && snap10["s10_latency"]["max"] == 300)
+check("S10-05: built-in gauges present", snap10.exist("network_tcp_sockets_open") && snap10.exist("network_async_pending"))
+var bad10 = false
+try
+    metrics.gauge_set("s10_events_total", 1)
+catch e
+    bad10 = true
+end
+check("S10-06: type conflict rejected", bad10)
+
+var srv10_port = find_free_port()
+if srv10_port == 0
+    check("S10-00: find free port", false)
+else
+    var srv10 = new netutils.http_server
+    srv10.set_config({"thread_count": 1, "worker_count": 1}.to_hash_map())
+    srv10.bind_metrics("/metrics")
+    srv10.bind_func("/hit", [](srv, session){
+        session.send_response("200 OK", "hit", "text/plain")
+    })
+    srv10.listen(srv10_port)
+    var i10 = 0
+    while i10 < 10
+        srv10.poll()
+        async.poll_once()
+        i10 += 1
+    end
+    var accepts10 = metrics.snapshot()["network_tcp_accepts_total"]
+
+    var client10 = new tcp.socket
+    client10.connect(tcp.endpoint("127.0.0.1", srv10_port))
+    client10.write("GET /hit HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n")
+    var start10 = runtime.time()
+    while client10.available() == 0 && runtime.time() - start10 < 5000
+        srv10.poll()
+        async.poll_once()
+        runtime.delay(5)
+    end
+    client10.receive(client10.available())
+    client10.write("GET /metrics HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n")
+    var resp10 = new string
+    start10 = runtime.time()
+    while runtime.time() - start10 < 5000
+        srv10.poll()
+        async.poll_once()
+        if client10.available() > 0
+            resp10 += client10.receive(client10.available())
+        else if client10.peer_closed()
+            break
+        end
+        runtime.delay(5)
+    end
+    client10.close()
+    check("S10-07: Prometheus content type", resp10.find("Content-Type: text/plain; version=0.0.4", 0) != -1)
+    check("S10-08: request counted by status", resp10.find("http_requests_total{code=\"200\"}", 0) != -1)
+    check("S10-09: latency exported as summary", resp10.find("# TYPE http_request_duration_milliseconds summary", 0) != -1)
+    check("S10-10: built-in socket gauge exported", resp10.find("network_tcp_sockets_open ", 0) != -1)
+    check("S10-11: accept counted", metrics.snapshot()["network_tcp_accepts_total"] > accepts10)
+    srv10.stop()
+    srv10 = null
+end
+
+# ============================================================
+# S11 -- Request tracing: Server-Timing header and trace log
+# ============================================================
+section("S11: request tracing")
+
+var srv11_port = find_free_port()
+var log11_path = "test_trace_" + to_string(srv11_port) + ".log"
+if srv11_port == 0
+    check("S11-00: find free port", false)
+else
+    var srv11 = new netutils.http_server
+    srv11.set_config({"thread_count": 1, "worker_count": 1, "trace_sample": 0.5, "access_log_flush": 10, "trace_log": log11_path}.to_hash_map())
+    check("S11-01: trace log opened", srv11.trace_log != null)
+    srv11.bind_func("/traced", [](srv, session){
+        session.send_response("200 OK", "traced", "text/plain")
+    })
+    srv11.listen(srv11_port)
+    var i11 = 0
+    while i11 < 10
+        srv11.poll()
+        async.poll_once()
+        i11 += 1
+    end
+
+    var client11 = new tcp.socket
+    client11.connect(tcp.endpoint("127.0.0.1", srv11_port))
+    var resp11 = new array
+    var n11 = 0
+    while n11 < 2
+        client11.write("GET /traced HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n")
+        var start11 = runtime.time()
+        while client11.available() == 0 && runtime.time() - start11 < 5000
+            srv11.poll()
+            async.poll_once()
+            runtime.delay(5)
+        end
+        resp11.push_back(client11.receive(client11.available()))
+        n11 += 1
+    end
+    i11 = 0
+    while i11 < 10
+        srv11.poll()
+        async.poll_once()
+        i11 += 1
+    end
+    client11.close()
+    # trace_sample 0.5 traces every second request
+    check("S11-02: untraced response has no Server-Timing", resp11[0].find("Server-Timing:", 0) == -1)
+    check("S11-03: traced response has Server-Timing", resp11[1].find("Server-Timing: wait;dur=", 0) != -1)
+    check("S11-04: handler stage reported", resp11[1].find("handler;dur=", 0) != -1)
+    srv11.trace_log.flush()
+    srv11.stop()
+
+    var log11 = netutils.read_file(log11_path)
+    check("S11-05: trace log line written", log11.find("/traced", 0) != -1)
+    check("S11-06: write stage logged", log11.find("\"write\"", 0) != -1)
+    system.file.remove(log11_path)
+    srv11 = null
+end
+
+# ============================================================
+# S12 -- Admission control: route limit (429) and in-flight limit (503)
+# ============================================================
+section("S12: admission control")
+
+var srv12_port = find_free_port()
+if srv12_port == 0
+    check("S12-00: find free port", false)
+else
+    var srv12 = new netutils.http_server
+    srv12.set_config({"thread_count": 1, "worker_count": 1, "max_inflight": 4, "retry_after": 2,
+        "route_limits": {"/limited": 1}.to_hash_map()}.to_hash_map())
+    srv12.bind_func("/limited", [](srv, session){
+        session.send_response("200 OK", "limited", "text/plain")
+    })
+    srv12.listen(srv12_port)
+    var i12 = 0
+    while i12 < 10
+        srv12.poll()
+        async.poll_once()
+        i12 += 1
+    end
+
+    var client12 = new tcp.socket
+    client12.connect(tcp.endpoint("127.0.0.1", srv12_port))
+    var resp12 = new array
+    var n12 = 0
+    while n12 < 3
+        # Simulate a handler already running on the route, then on the server
+        if n12 == 1
+            srv12.route_inflight["/limited"] = 1
+        else if n12 == 2
+            srv12.route_inflight["/limited"] = 0
+            srv12.inflight = 4
+        end
+        client12.write("GET /limited HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n")
+        var start12 = runtime.time()
+        while client12.available() == 0 && runtime.time() - start12 < 5000
+            srv12.poll()
+            async.poll_once()
+            runtime.delay(5)
+        end
+        resp12.push_back(client12.receive(client12.available()))
+        n12 += 1
+    end
+    srv12.inflight = 0
+    client12.close()
+    check("S12-01: request under the limits served", resp12[0].find("HTTP/1.1 200 OK", 0) == 0)
+    check("S12-02: route limit answers 429", resp12[1].find("HTTP/1.1 429 Too Many Requests", 0) == 0)
+    check("S12-03: 429 carries Retry-After", resp12[1].find("Retry-After: 2\r\n", 0) != -1)
+    check("S12-04: in-flight limit answers 503", resp12[2].find("HTTP/1.1 503 Service Unavailable", 0) == 0)
+    check("S12-05: served response has no Retry-After", resp12[0].find("Retry-After:", 0) == -1)
+    var snap12 = metrics.snapshot()
+    check_eq("S12-06: route shed counted", snap12["http_requests_shed_total{reason=\"route\"}"], 1)
+    check_eq("S12-07: in-flight shed counted", snap12["http_requests_shed_total{reason=\"inflight\"}"], 1)
+    var stats12 = srv12.admission_stats()
+    check_eq("S12-08: no handler left running", stats12["inflight"], 0)
+    srv12.set_route_limit("*", "/limited", 0)
+    check("S12-09: route limit removed", !srv12.route_limits.exist("/limited"))
+    srv12.stop()
+    srv12 = null
+end
+
+# ============================================================
+# S13 -- Per-client rate limiting
+# ============================================================
+section("S13: rate limiting")
+
+var limiter13 = http.rate_limiter(1, 2, 1024)
+check_eq("S13-01: burst admitted", limiter13.acquire("k"), 0)
+check_eq("S13-02: burst admitted", limiter13.acquire("k"), 0)
+check_eq("S13-03: over burst waits a second", limiter13.acquire("k"), 1)
+check_eq("S13-04: other key unaffected", limiter13.acquire("other"), 0)
+check_eq("S13-05: keys tracked", limiter13.size(), 2)
+check_eq("S13-06: cost over available tokens waits", limiter13.acquire_n("other", 2), 1)
+var bad13 = false
+try
+    http.rate_limiter(0, 1, 1)
+catch e
+    bad13 = true
+end
+check("S13-07: zero rate rejected", bad13)
+var over_burst13 = false
+try
+    limiter13.acquire_n("other", 3)
+catch e
+    over_burst13 = true
+end
+check("S13-08: cost over burst rejected", over_burst13)
+
+var srv13_port = find_free_port()
+if srv13_port == 0
+    check("S13-00: find free port", false)
+else
+    var srv13 = new netutils.http_server
+    srv13.set_config({"thread_count": 1, "worker_count": 1, "rate_limit": 1, "rate_limit_burst": 2}.to_hash_map())
+    srv13.bind_func("/rated", [](srv, session){
+        session.send_response("200 OK", "rated", "text/plain")
+    })
+    srv13.listen(srv13_port)
+    var i13 = 0
+    while i13 < 10
+        srv13.poll()
+        async.poll_once()
+        i13 += 1
+    end
+
+    var client13 = new tcp.socket
+    client13.connect(tcp.endpoint("127.0.0.1", srv13_port))
+    var resp13 = new array
+    var n13 = 0
+    while n13 < 4
+        var request13 = "GET /rated HTTP/1.1\r\nHost: 127.0.0.1\r\n"
+        if n13 == 3
+            # Keyed by header instead of address: a fresh bucket
+            srv13.rate_limit_key = "x-client"
+            request13 += "X-Client: s13\r\n"
+        end
+        client13.write(request13 + "\r\n")
+        var start13 = runtime.time()
+        while client13.available() == 0 && runtime.time() - start13 < 5000
+            srv13.poll()
+            async.poll_once()
+            runtime.delay(5)
+        end
+        resp13.push_back(client13.receive(client13.available()))
+        n13 += 1
+    end
+    client13.close()
+    check("S13-09: requests within burst served", resp13[0].find("HTTP/1.1 200 OK", 0) == 0 && resp13[1].find("HTTP/1.1 200 OK", 0) == 0)
+    check("S13-10: request over the rate gets 429", resp13[2].find("HTTP/1.1 429 Too Many Requests", 0) == 0)
+    check("S13-11: 429 carries Retry-After", resp13[2].find("Retry-After: 1\r\n", 0) != -1)
+    check("S13-12: header key has its own bucket", resp13[3].find("HTTP/1.1 200 OK", 0) == 0)
+    check_eq("S13-13: rate shed counted", metrics.snapshot()["http_requests_shed_total{reason=\"rate\"}"], 1)
+
+    # Rejected before the body is read: the answer does not wait for it
+    client13 = new tcp.socket
+    client13.connect(tcp.endpoint("127.0.0.1", srv13_port))
+    client13.write("POST /rated HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: 1048576\r\n\r\n")
+    var start13 = runtime.time()
+    while client13.available() == 0 && runtime.time() - start13 < 5000
+        srv13.poll()
+        async.poll_once()
+        runtime.delay(5)
+    end
+    var reply13 = client13.receive(client13.available())
+    client13.close()
+    check("S13-14: over the rate with an unsent body gets 429", reply13.find("HTTP/1.1 429 Too Many Requests", 0) == 0)
+    check("S13-15: unread body closes the connection", reply13.find("Connection: close\r\n", 0) != -1)
+    srv13.stop()
+    srv13 = null
+end
+
+# ============================================================
+# S14 -- Graceful drain and listener handoff
+# ============================================================
+section("S14: drain and listener handoff")
+
+function who_handler(srv, session)
+    session.send_response("200 OK", "parent", "text/plain")
+end
+
+var srv14_port = find_free_port()
+if srv14_port == 0
+    check("S14-00: find free port", false)
+else
+    var srv14 = new netutils.http_server
+    srv14.set_config({"thread_count": 1, "worker_count": 2, "keep_alive_timeout": 10000}.to_hash_map())
+    srv14.bind_func("/who", who_handler)
+    srv14.listen(srv14_port)
+    var i14 = 0
+    while i14 < 10
+        srv14.poll()
+        async.poll_once()
+        i14 += 1
+    end
+
+    # Served once, then idle on keep-alive
+    var client14 = new tcp.socket
+    client14.connect(tcp.endpoint("127.0.0.1", srv14_port))
+    client14.write("GET /who HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n")
+    var resp14 = ""
+    var start14 = runtime.time()
+    while resp14.find("parent", 0) == -1 && runtime.time() - start14 < 5000
+        if client14.available() > 0
+            resp14 += client14.receive(client14.available())
+        end
+        srv14.poll()
+        async.poll_once()
+        runtime.delay(5)
+    end
+    check("S14-01: keep-alive request served", resp14.find("HTTP/1.1 200 OK", 0) == 0)
+
+    srv14.drain(5000)
+    var refused14 = false
+    var late14 = new tcp.socket
+    try
+        late14.connect(tcp.endpoint("127.0.0.1", srv14_port))
+        late14.write("GET /who HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n")
+    catch e
+        refused14 = true
+    end
+    start14 = runtime.time()
+    while !srv14.stopped && runtime.time() - start14 < 2000
+        srv14.poll()
+        async.poll_once()
+        runtime.delay(5)
+    end
+    check("S14-02: idle keep-alive read does not hold up drain", srv14.stopped)
+    if !refused14
+        # Queued before the listener closed at most: never answered
+        runtime.delay(100)
+        refused14 = late14.available() == 0
+    end
+    check("S14-03: drained port accepts nothing", refused14)
+    late14.close()
+    client14.close()
+    srv14 = null
+end
+
+# A replacement process adopts the exported listener and serves on it
+var srv14b_port = find_free_port()
+if srv14b_port == 0
+    check("S14-00: find free port", false)
+else
+    var srv14b = new netutils.http_server
+    srv14b.listen(srv14b_port)
+    var handles14 = srv14b.export_listeners()
+    check("S14-04: http listener exported", handles14.exist("http") && !handles14.exist("master"))
+
+    var child14_path = "build/s14_child.csc"
+    var child14 = iostream.fstream(child14_path, iostream.openmode.out)
+    child14.println("import netutils")
+    child14.println("function who_handler(srv, session)")
+    child14.println("    session.send_response(\"200 OK\", \"child\", \"text/plain\")")
+    child14.println("    srv.drain(1000)")
+    child14.println("end")
+    child14.println("var srv = new netutils.http_server")
+    child14.println("srv.set_config({\"thread_count\": 1, \"worker_count\": 1}.to_hash_map())")
+    child14.println("srv.bind_func(\"/who\", who_handler)")
+    child14.println("srv.listen_handle(context.cmd_args[1] as integer)")
+    child14.println("var start = runtime.time()")
+    child14.println("while !srv.stopped && runtime.time() - start < 15000")
+    child14.println("    srv.poll()")
+    child14.println("end")
+    child14 = null
+
+    var builder14 = new process.builder
+    builder14.cmd("cs").arg({"-i", runtime.get_import_path(), child14_path, to_string(handles14["http"])})
+    var proc14 = builder14.start()
+    # The parent lets go of the port; the child's copy keeps it open
+    srv14b.drain(0)
+    srv14b.poll()
+
+    var client14b = new tcp.socket
+    client14b.connect(tcp.endpoint("127.0.0.1", srv14b_port))
+    client14b.write("GET /who HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n")
+    var resp14b = ""
+    var start14b = runtime.time()
+    while resp14b.find("child", 0) == -1 && runtime.time() - start14b < 15000
+        if client14b.available() > 0
+            resp14b += client14b.receive(client14b.available())
+        end
+        runtime.delay(10)
+    end
+    check("S14-05: adopted listener serves in the new process", resp14b.find("HTTP/1.1 200 OK", 0) == 0 && resp14b.find("child", 0) != -1)
+    client14b.close()
+    start14b = runtime.time()
+    while !proc14.has_exited() && runtime.time() - start14b < 5000
+        runtime.delay(10)
+    end
+    check("S14-06: new process drains and exits", proc14.has_exited())
+    if !proc14.has_exited()
+        proc14.kill(true)
+    end
+    system.file.remove(child14_path)
+    srv14b = null
+end
+
 # Results
 system.out.println("")
 system.out.println("=== Results ===")
@@ -362,6 +362,443 @@ check("M05-04: handler called", g_called)
 client5.close()
 s5.stop(); m5.stop(); s5 = null; m5 = null
 
+# ============================================================
+# M06 -- Load-aware slave selection
+# ============================================================
+section("M06: load-aware slave selection")
+
+var http6 = alloc_port()
+var slave6 = alloc_port()
+system.out.println("M06 HTTP=" + to_string(http6) + " Slave=" + to_string(slave6))
+
+var m6 = new netutils.http_server
+m6.set_config({"thread_count": 2, "worker_count": 2, "balance_policy": "ewma"}.to_hash_map())
+check_eq("M06-01: policy from config", m6.balance_policy, "ewma")
+m6.set_balance_policy("no_such_policy")
+check_eq("M06-02: unknown policy falls back", m6.balance_policy, "round_robin")
+m6.set_balance_policy("p2c")
+m6.bind_func("/echo", echo_handler)
+m6.set_master(slave6)
+m6.listen(http6)
+
+var s6 = new netutils.http_server
+s6.set_config({"thread_count": 2, "worker_count": 2}.to_hash_map())
+s6.bind_func("/echo", echo_handler)
+s6.set_slave("127.0.0.1", slave6)
+
+drive_both_cycles(m6, s6, 40)
+
+var client6 = new tcp.socket
+client6.connect(tcp.endpoint("127.0.0.1", http6))
+var ok6 = true
+foreach i in range(4)
+    client6.write("GET /echo HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: keep-alive\r\n\r\n")
+    if !drive_until_data(client6, m6, s6, 5000)
+        ok6 = false
+        break
+    end
+    var r6 = drain_response(client6, "echo: /echo", m6, s6, 2000)
+    if r6.find("echo: /echo", 0) == -1
+        ok6 = false
+    end
+end
+check("M06-03: requests served under p2c", ok6)
+
+var stats6 = m6.slave_stats()
+check_eq("M06-04: one stats entry per slave connection", stats6.size, 2)
+if stats6.size == 2
+    check_eq("M06-05: connections grouped by slave process", stats6[0]["group"], stats6[1]["group"])
+    check_eq("M06-06: dispatched counted per process", stats6[0]["dispatched"], 4)
+    check_eq("M06-07: nothing in flight", stats6[0]["inflight"], 0)
+    check("M06-08: latency recorded", stats6[0]["ewma_latency"] >= 0)
+end
+
+client6.close()
+s6.stop(); m6.stop(); s6 = null; m6 = null
+
+# ============================================================
+# M07 -- Pipelined requests through the master event queues
+# ============================================================
+section("M07: pipelined requests keep order")
+
+var http7 = alloc_port()
+var slave7 = alloc_port()
+system.out.println("M07 HTTP=" + to_string(http7) + " Slave=" + to_string(slave7))
+
+var m7 = new netutils.http_server
+m7.set_config({"thread_count": 2, "worker_count": 2, "balance_policy": "least_outstanding"}.to_hash_map())
+m7.bind_func("/echo", echo_handler)
+m7.set_master(slave7)
+m7.listen(http7)
+
+var s7 = new netutils.http_server
+s7.set_config({"thread_count": 2, "worker_count": 2}.to_hash_map())
+s7.bind_func("/echo", echo_handler)
+s7.set_slave("127.0.0.1", slave7)
+
+drive_both_cycles(m7, s7, 40)
+
+var client7 = new tcp.socket
+client7.connect(tcp.endpoint("127.0.0.1", http7))
+client7.write("GET /echo/1 HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n" +
+    "GET /echo/2 HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n" +
+    "GET /echo/3 HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n")
+var r7 = ""
+if drive_until_data(client7, m7, s7, 5000)
+    r7 = drain_response(client7, "echo: /echo/3", m7, s7, 5000)
+end
+var p7a = r7.find("echo: /echo/1", 0)
+var p7b = r7.find("echo: /echo/2", 0)
+var p7c = r7.find("echo: /echo/3", 0)
+check("M07-01: all pipelined responses received", p7a != -1 && p7b != -1 && p7c != -1)
+check("M07-02: responses in request order", p7a < p7b && p7b < p7c)
+
+# Closed connections leave the connection table
+var start7 = runtime.time()
+while m7.conn_map.size > 0 && runtime.time() - start7 < 2000
+    drive_both(m7, s7)
+    runtime.delay(5)
+end
+check_eq("M07-03: connection table drained", m7.conn_map.size, 0)
+
+client7.close()
+s7.stop(); m7.stop(); s7 = null; m7 = null
+
+# ============================================================
+# M08 -- Streamed request bodies
+# ============================================================
+section("M08: streamed request body forwarding")
+
+function stream_handler(srv, session)
+    var body = ""
+    var chunks = 0
+    loop
+        var chunk = session.read_body()
+        if chunk == null || chunk.empty()
+            break
+        end
+        body += chunk
+        chunks += 1
+    end
+    session.send_response("200 OK", "chunks=" + to_string(chunks) + " body=" + body, "text/plain")
+end
+
+function ignore_body_handler(srv, session)
+    session.send_response("200 OK", "ignored", "text/plain")
+end
+
+var http8 = alloc_port()
+var slave8 = alloc_port()
+system.out.println("M08 HTTP=" + to_string(http8) + " Slave=" + to_string(slave8))
+
+var m8 = new netutils.http_server
+m8.set_config({"thread_count": 2, "worker_count": 2, "body_stream_threshold": 16, "body_stream_chunk": 8, "body_stream_window": 4}.to_hash_map())
+check_eq("M08-01: window clamped to chunk size", m8.body_stream_window, 8)
+m8.bind_func("/upload", stream_handler)
+m8.bind_func("/ignore", ignore_body_handler)
+m8.set_master(slave8)
+m8.listen(http8)
+
+var s8 = new netutils.http_server
+s8.set_config({"thread_count": 2, "worker_count": 2}.to_hash_map())
+s8.bind_func("/upload", stream_handler)
+s8.bind_func("/ignore", ignore_body_handler)
+s8.set_slave("127.0.0.1", slave8)
+
+drive_both_cycles(m8, s8, 40)
+
+var client8 = new tcp.socket
+client8.connect(tcp.endpoint("127.0.0.1", http8))
+var body8 = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
+client8.write("POST /upload HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: " + to_string(body8.size) + "\r\n\r\n" + body8)
+var r8a = ""
+if drive_until_data(client8, m8, s8, 5000)
+    r8a = drain_response(client8, body8, m8, s8, 5000)
+end
+check("M08-02: streamed body reassembled", r8a.find("body=" + body8, 0) != -1)
+check("M08-03: body arrived in chunks", r8a.find("chunks=8 ", 0) != -1)
+
+# Unread body is drained by the slave; the connection stays usable
+client8.write("POST /ignore HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: " + to_string(body8.size) + "\r\n\r\n" + body8)
+var r8b = ""
+if drive_until_data(client8, m8, s8, 5000)
+    r8b = drain_response(client8, "ignored", m8, s8, 5000)
+end
+check("M08-04: handler may skip the body", r8b.find("ignored", 0) != -1)
+
+client8.write("POST /upload HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: 5\r\nConnection: close\r\n\r\nsmall")
+var r8c = ""
+if drive_until_data(client8, m8, s8, 5000)
+    r8c = drain_response(client8, "small", m8, s8, 5000)
+end
+check("M08-05: small body still buffered", r8c.find("chunks=1 body=small", 0) != -1)
+
+client8.close()
+s8.stop(); m8.stop(); s8 = null; m8 = null
+
+# ============================================================
+# M09 -- Slave supervisor configuration
+# ============================================================
+section("M09: slave supervisor configuration")
+
+var m9 = new netutils.http_server
+m9.set_config({"slave_count": 3}.to_hash_map())
+check_eq("M09-01: slave_count sets target", m9.slave_target, 3)
+check_eq("M09-02: no autoscale by default", m9.slave_max, 3)
+check("M09-03: supervisor off without command", m9.slave_command == null)
+
+m9.set_config({"slave_count": 1, "slave_min": 2, "slave_max": 1, "slave_restart_backoff": 500, "slave_restart_backoff_max": 10}.to_hash_map())
+check_eq("M09-04: target raised to slave_min", m9.slave_target, 2)
+check_eq("M09-05: slave_max not below slave_min", m9.slave_max, 2)
+check_eq("M09-06: backoff cap not below initial backoff", m9.slave_restart_backoff_max, 500)
+
+m9.set_slave_command({"cs", "slave.csc"})
+check_eq("M09-07: command stored", m9.slave_command.size, 2)
+m9.set_slave_command(new array)
+check("M09-08: empty command disables supervisor", m9.slave_command == null)
+check_eq("M09-09: no processes before init", m9.supervisor_stats().size, 0)
+m9 = null
+
+function drive_master(master)
+    master.poll()
+    async.poll_once()
+    runtime.delay(5)
+end
+
+# Supervised slave processes: restarted when killed, retired on scale-down
+var http9 = alloc_port()
+var slave9 = alloc_port()
+system.out.println("M09 HTTP=" + to_string(http9) + " Slave=" + to_string(slave9))
+var script9 = "build/m09_slave.csc"
+var file9 = iostream.fstream(script9, iostream.openmode.out)
+file9.println("import netutils")
+file9.println("function echo_handler(srv, session)")
+file9.println("    session.send_response(\"200 OK\", \"supervised: \" + session.url, \"text/plain\")")
+file9.println("end")
+file9.println("var s = new netutils.http_server")
+file9.println("s.set_config({\"thread_count\": 1, \"worker_count\": 1, \"instance_id\": context.cmd_args[1]}.to_hash_map())")
+file9.println("s.bind_func(\"/api/echo\", echo_handler)")
+file9.println("s.set_slave(\"127.0.0.1\", " + to_string(slave9) + ")")
+file9.println("s.run()")
+file9 = null
+
+var m9b = new netutils.http_server
+m9b.set_config({"thread_count": 2, "worker_count": 2, "slave_count": 2, "slave_restart_backoff": 100, "heartbeat_interval": 200, "rolling_timeout": 10000}.to_hash_map())
+m9b.set_slave_command({"cs", "-i", runtime.get_import_path(), script9, "{instance_id}"})
+m9b.set_master(slave9)
+m9b.listen(http9)
+
+var start9 = runtime.time()
+while m9b.slave_groups.size < 2 && runtime.time() - start9 < 20000
+    drive_master(m9b)
+end
+check_eq("M09-10: supervised slaves connect", m9b.slave_groups.size, 2)
+var owned9 = 0
+foreach proc in m9b.slave_procs
+    if m9b.slave_groups.exist(proc->instance_id)
+        ++owned9
+    end
+end
+check_eq("M09-11: supervised slaves announce their instance id", owned9, 2)
+var groups9 = new hash_set
+foreach it in m9b.slave_groups do groups9.insert(it.first)
+
+m9b.slave_procs[0]->handle.kill(true)
+start9 = runtime.time()
+while m9b.supervisor_stats()[0]["restarts"] == 0 && runtime.time() - start9 < 5000
+    drive_master(m9b)
+end
+check_eq("M09-12: killed slave restarted", m9b.supervisor_stats()[0]["restarts"], 1)
+# The dead process' connections fail their next heartbeat; wait until
+# they are gone and the replacement has joined
+start9 = runtime.time()
+loop
+    drive_master(m9b)
+    var fresh = 0
+    foreach it in m9b.slave_groups
+        if !groups9.exist(it.first)
+            ++fresh
+        end
+    end
+    if (fresh == 1 && m9b.slave_groups.size == 2) || runtime.time() - start9 >= 20000
+        break
+    end
+end
+var fresh9 = 0
+foreach it in m9b.slave_groups
+    if !groups9.exist(it.first)
+        ++fresh9
+    end
+end
+check("M09-13: restarted slave reconnects under a new instance id", fresh9 == 1 && m9b.slave_groups.size == 2)
+
+# Scale down: the surplus slave drains and exits on its own, and the
+# externally started slave is not picked for retirement
+var s9 = new netutils.http_server
+s9.set_config({"thread_count": 1, "worker_count": 1}.to_hash_map())
+s9.bind_func("/api/echo", [](srv, session){
+    session.send_response("200 OK", "supervised: " + session.url, "text/plain")
+})
+s9.set_slave("127.0.0.1", slave9)
+start9 = runtime.time()
+while m9b.slave_groups.size < 3 && runtime.time() - start9 < 5000
+    drive_both(m9b, s9)
+    runtime.delay(5)
+end
+m9b.slave_target = 1
+start9 = runtime.time()
+while (m9b.slave_procs.size > 1 || m9b.slave_groups.size > 2) && runtime.time() - start9 < 15000
+    drive_both(m9b, s9)
+    runtime.delay(5)
+end
+check_eq("M09-14: surplus slot removed", m9b.slave_procs.size, 1)
+check_eq("M09-15: retired slave left the master", m9b.slave_groups.size, 2)
+check("M09-16: external slave kept", m9b.slave_groups.exist(s9.instance_id) && !s9.stopped)
+var restarts9 = 0
+foreach st in m9b.supervisor_stats() do restarts9 += st["restarts"]
+check("M09-17: retired slave not restarted", restarts9 <= 1 && m9b.supervisor_stats()[0]["running"])
+var client9 = new tcp.socket
+client9.connect(tcp.endpoint("127.0.0.1", http9))
+client9.write("POST /api/echo HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: 2\r\nConnection: close\r\n\r\nhi")
+var r9 = ""
+start9 = runtime.time()
+while r9.find("supervised: /api/echo", 0) == -1 && runtime.time() - start9 < 5000
+    if client9.available() > 0
+        r9 += client9.receive(client9.available())
+    end
+    drive_both(m9b, s9)
+    runtime.delay(5)
+end
+check("M09-18: POST served after scale-down", r9.find("HTTP/1.1 200 OK", 0) == 0)
+client9.close()
+s9.stop()
+s9 = null
+m9b.stop()
+m9b = null
+system.file.remove(script9)
+
+# ============================================================
+# M10 -- Rolling slave replacement and graceful drain
+# ============================================================
+section("M10: rolling replacement and drain")
+
+var http10 = alloc_port()
+var slave10 = alloc_port()
+system.out.println("M10 HTTP=" + to_string(http10) + " Slave=" + to_string(slave10))
+
+var m10 = new netutils.http_server
+m10.set_config({"thread_count": 2, "worker_count": 2, "keep_alive_timeout": 500, "rolling_timeout": 0}.to_hash_map())
+m10.bind_func("/api/echo", echo_handler)
+m10.set_master(slave10)
+m10.listen(http10)
+
+var s10 = new netutils.http_server
+s10.set_config({"thread_count": 2, "worker_count": 2}.to_hash_map())
+s10.bind_func("/api/echo", echo_handler)
+s10.set_slave("127.0.0.1", slave10)
+
+drive_both_cycles(m10, s10, 40)
+
+var client10 = new tcp.socket
+client10.connect(tcp.endpoint("127.0.0.1", http10))
+client10.write("GET /api/echo HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n")
+var r10 = ""
+if drive_until_data(client10, m10, s10, 5000)
+    r10 = drain_response(client10, "echo: /api/echo", m10, s10, 5000)
+end
+check("M10-01: served before rolling restart", r10.find("echo: /api/echo", 0) != -1)
+
+var handles10 = m10.export_listeners()
+check("M10-02: listeners exported", handles10.exist("http") && handles10.exist("master"))
+
+# The slave is told to retire, drains and stops itself
+m10.rolling_restart()
+check_eq("M10-03: one slave queued for replacement", m10.retire_queue.size, 1)
+var start10 = runtime.time()
+while !s10.stopped && runtime.time() - start10 < 5000
+    drive_both(m10, s10)
+    runtime.delay(5)
+end
+check("M10-04: retired slave stopped", s10.stopped)
+drive_both_cycles(m10, s10, 20)
+check("M10-05: retired slave left the master", m10.slave_list.empty())
+check_eq("M10-06: retire queue consumed", m10.retire_queue.size, 0)
+
+# Draining closes the idle keep-alive connection and stops the master
+m10.drain(5000)
+check("M10-07: draining", m10.draining)
+start10 = runtime.time()
+while !m10.stopped && runtime.time() - start10 < 5000
+    drive_both(m10, s10)
+    runtime.delay(5)
+end
+check("M10-08: master stopped once drained", m10.stopped)
+
+client10.close()
+s10 = null; m10 = null
+
+# ============================================================
+# M11 -- Idle keep-alive connections
+# ============================================================
+section("M11: idle connections do not hold request workers")
+
+var http11 = alloc_port()
+var slave11 = alloc_port()
+system.out.println("M11 HTTP=" + to_string(http11) + " Slave=" + to_string(slave11))
+
+var m11 = new netutils.http_server
+m11.set_config({"thread_count": 2, "worker_count": 2, "master_worker_count": 1, "keep_alive_timeout": 10000}.to_hash_map())
+m11.bind_func("/api/echo", echo_handler)
+m11.set_master(slave11)
+m11.listen(http11)
+
+var s11 = new netutils.http_server
+s11.set_config({"thread_count": 2, "worker_count": 2}.to_hash_map())
+s11.bind_func("/api/echo", echo_handler)
+s11.set_slave("127.0.0.1", slave11)
+
+drive_both_cycles(m11, s11, 40)
+
+# More silent clients than request workers, connected first
+var idle11 = new array
+foreach i in range(3)
+    var c = new tcp.socket
+    c.connect(tcp.endpoint("127.0.0.1", http11))
+    idle11.push_back(c)
+end
+drive_both_cycles(m11, s11, 40)
+
+var client11 = new tcp.socket
+client11.connect(tcp.endpoint("127.0.0.1", http11))
+client11.write("GET /api/echo HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n")
+var r11 = ""
+if drive_until_data(client11, m11, s11, 3000)
+    r11 = drain_response(client11, "echo: /api/echo", m11, s11, 3000)
+end
+check("M11-01: request served while idle clients stay silent", r11.find("echo: /api/echo", 0) != -1)
+check_eq("M11-02: idle connections kept", m11.conn_map.size, 4)
+
+# An idle client that speaks up later is served too
+idle11[0].write("GET /api/echo/late HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n")
+var r11b = ""
+if drive_until_data(idle11[0], m11, s11, 3000)
+    r11b = drain_response(idle11[0], "echo: /api/echo/late", m11, s11, 3000)
+end
+check("M11-03: late request on an idle connection served", r11b.find("echo: /api/echo/late", 0) != -1)
+
+# Draining closes the idle connections at once
+m11.drain(5000)
+var start11 = runtime.time()
+while !m11.stopped && runtime.time() - start11 < 2000
+    drive_both(m11, s11)
+    runtime.delay(5)
+end
+check("M11-04: drain does not wait for idle reads", m11.stopped)
+
+foreach c in idle11 do c.close()
+client11.close()
+s11.stop(); s11 = null; m11 = null
+
 # ============================================================
 # Results
 # ============================================================
@@ -248,6 +248,48 @@ var ep = results[0]
 check("S08-02: resolved endpoint is_v4", ep.is_v4())
 check_eq("S08-03: resolved port matches", ep.port(), server_port)
 
+section("S09: latency tuning options")
+
+var acpt9 = tcp.acceptor(tcp.endpoint_v4(server_port + 7))
+# Platform-specific options report whether they applied; they must not throw
+acpt9.set_opt_fast_open(16)
+acpt9.set_opt_defer_accept(0)
+var srv9 = new tcp.socket
+var ast9 = async.accept(srv9, acpt9)
+var cli9 = new tcp.socket
+cli9.connect(tcp.endpoint("127.0.0.1", server_port + 7))
+check("S09-01: accepted with listener options", ast9.wait_for(5000))
+cli9.set_opt_quick_ack(true)
+cli9.set_opt_cork(true)
+cli9.set_opt_cork(false)
+cli9.set_opt_notsent_lowat(16384)
+cli9.set_opt_keep_alive(true)
+cli9.set_opt_keep_alive_params(30, 5, 3)
+cli9.set_opt_user_timeout(10000)
+cli9.set_opt_busy_poll(0)
+cli9.set_opt_linger(true, 1)
+check("S09-02: receive buffer applied", cli9.set_opt_receive_buffer(262144) > 0)
+check("S09-03: send buffer applied", cli9.set_opt_send_buffer(262144) > 0)
+cli9.write("tune")
+check_eq("S09-04: tuned socket still delivers", srv9.read(4), "tune")
+if system.is_platform_linux()
+    var info9 = cli9.tcp_info()
+    check("S09-05: tcp_info reports rtt", info9.exist("rtt_us") && info9["rtt_us"] >= 0)
+    check("S09-06: tcp_info reports cwnd", info9["snd_cwnd"] > 0)
+end
+
+var bad_keepalive_rejected = false
+try
+    cli9.set_opt_keep_alive_params(0, 5, 3)
+catch e
+    bad_keepalive_rejected = true
+end
+check_true("S09-07: invalid keep-alive timing rejected", bad_keepalive_rejected)
+
+cli9.close()
+srv9.close()
+acpt9.close()
+
 system.out.println("")
 system.out.println("=== Results ===")
 system.out.println("PASS: " + _pass)
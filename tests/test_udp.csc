@@ -197,6 +197,184 @@ catch e
 end
 check("U07-02: oversized async receive rejected", oversized_receive_rejected)
 
+section("U08: batched receive and send")
+
+var port8 = 13010
+var batch_rx = new udp.socket
+var batch_tx = new udp.socket
+batch_rx.open_v4()
+batch_tx.open_v4()
+batch_rx.bind(udp.endpoint_v4(port8))
+batch_tx.bind(udp.endpoint_v4(port8 + 1))
+
+var batch_target = udp.endpoint("127.0.0.1", port8)
+var outgoing = new array
+foreach i in range(8)
+    outgoing.push_back({"batch-" + i, batch_target})
+end
+check_eq("U08-01: send_batch count", batch_tx.send_batch(outgoing), 8)
+
+var received_batch = new array
+var batch_rounds = 0
+while received_batch.size < 8 && batch_rounds < 16
+    foreach item in batch_rx.receive_batch(4, 64, 1000)
+        received_batch.push_back(item)
+    end
+    ++batch_rounds
+end
+check_eq("U08-02: all datagrams received", received_batch.size, 8)
+if received_batch.size == 8
+    check_eq("U08-03: first payload", received_batch.front.first, "batch-0")
+    check_eq("U08-04: sender port", received_batch.front.second.port(), port8 + 1)
+end
+check_eq("U08-05: empty queue times out", batch_rx.receive_batch(4, 64, 50).size, 0)
+
+batch_tx.send_batch({{"async-batch", batch_target}})
+var batch_state = async.receive_batch(batch_rx, 16, 64)
+if batch_state.wait_for(3000)
+    var async_batch = batch_state.get_batch()
+    check("U08-06: async batch received", async_batch.size >= 1 && async_batch.front.first == "async-batch")
+else
+    check("U08-06: async batch received", false)
+end
+
+var oversized_batch_rejected = false
+try
+    batch_rx.receive_batch(1025, 64, 0)
+catch e
+    oversized_batch_rejected = true
+end
+check("U08-07: oversized batch rejected", oversized_batch_rejected)
+
+batch_rx.close()
+batch_tx.close()
+
+section("U09: segmentation offload")
+
+var port9 = 13020
+var gso_rx = new udp.socket
+var gso_tx = new udp.socket
+gso_rx.open_v4()
+gso_tx.open_v4()
+gso_rx.bind(udp.endpoint_v4(port9))
+gso_tx.bind(udp.endpoint_v4(port9 + 1))
+gso_rx.set_opt_gro(true)
+
+var gso_payload = ""
+foreach i in range(10)
+    gso_payload += "segment-" + i + "|"
+end
+var segment_size = ("segment-0|").size
+var gso_count = gso_tx.send_segmented(gso_payload, segment_size, udp.endpoint("127.0.0.1", port9))
+check_eq("U09-01: send_segmented count", gso_count, 10)
+
+var segments = new array
+var gso_rounds = 0
+while segments.size < 10 && gso_rounds < 16
+    foreach item in gso_rx.receive_batch(16, 64, 1000)
+        segments.push_back(item.first)
+    end
+    ++gso_rounds
+end
+check_eq("U09-02: segments received", segments.size, 10)
+if segments.size == 10
+    check_eq("U09-03: segment boundaries kept", segments.back, "segment-9|")
+end
+
+var zero_segment_rejected = false
+try
+    gso_tx.send_segmented("x", 0, udp.endpoint("127.0.0.1", port9))
+catch e
+    zero_segment_rejected = true
+end
+check("U09-04: zero segment size rejected", zero_segment_rejected)
+
+gso_rx.close()
+gso_tx.close()
+
+section("U10: multicast and buffer options")
+
+var tune_sock = new udp.socket
+tune_sock.open_v4()
+tune_sock.bind(udp.endpoint_v4(13030))
+check("U10-01: receive buffer applied", tune_sock.set_opt_receive_buffer(1048576) > 0)
+check("U10-02: send buffer applied", tune_sock.set_opt_send_buffer(262144) > 0)
+tune_sock.set_opt_multicast_ttl(4)
+tune_sock.set_opt_multicast_loop(true)
+var ovfl_enabled = tune_sock.set_opt_rxq_ovfl(true)
+check("U10-03: rxq_ovfl returns boolean", ovfl_enabled == true || ovfl_enabled == false)
+check_eq("U10-04: no drops yet", tune_sock.dropped(), 0)
+
+var unicast_group_rejected = false
+try
+    tune_sock.join_group("127.0.0.1", "")
+catch e
+    unicast_group_rejected = true
+end
+check("U10-05: unicast group rejected", unicast_group_rejected)
+
+var bad_ttl_rejected = false
+try
+    tune_sock.set_opt_multicast_ttl(256)
+catch e
+    bad_ttl_rejected = true
+end
+check("U10-06: out-of-range TTL rejected", bad_ttl_rejected)
+
+tune_sock.close()
+
+section("U11: multi receiver")
+
+var port11 = 13040
+var multi_rx = new udp.socket
+var multi_tx = new udp.socket
+multi_rx.open_v4()
+multi_tx.open_v4()
+multi_rx.bind(udp.endpoint_v4(port11))
+multi_tx.bind(udp.endpoint_v4(port11 + 1))
+
+var receiver = udp.multi_receiver(multi_rx, 4, 256, 1024)
+var single_receive_rejected = false
+try
+    async.receive_from(multi_rx, 100)
+catch e
+    single_receive_rejected = true
+end
+check("U11-01: receive slot held by multi receiver", single_receive_rejected)
+
+var multi_target = udp.endpoint("127.0.0.1", port11)
+var multi_out = new array
+foreach i in range(20)
+    multi_out.push_back({"multi-" + i, multi_target})
+end
+multi_tx.send_batch(multi_out)
+
+var multi_in = new array
+var multi_rounds = 0
+while multi_in.size < 20 && multi_rounds < 50
+    if receiver.wait_for(100)
+        foreach item in receiver.receive(8)
+            multi_in.push_back(item.first)
+        end
+    end
+    ++multi_rounds
+end
+check_eq("U11-02: all datagrams queued", multi_in.size, 20)
+check_eq("U11-03: no overflow", receiver.overflow(), 0)
+check("U11-04: stop releases the socket", receiver.stop())
+check("U11-05: no error after stop", receiver.error() == null)
+
+var after_stop = async.receive_from(multi_rx, 100)
+multi_tx.send_to("after-stop", multi_target)
+if after_stop.wait_for(3000)
+    check_eq("U11-06: single receive works again", after_stop.get_result(), "after-stop")
+else
+    check("U11-06: single receive works again", false)
+end
+
+multi_rx.close()
+multi_tx.close()
+
 system.out.println("")
 system.out.println("=== Results ===")
 system.out.println("PASS: " + _pass)